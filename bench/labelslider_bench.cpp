@@ -0,0 +1,467 @@
+#include "labelslider.h"
+#include "labelsliderbank.h"
+#include "labelslidergroup.h"
+
+#include <QApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QMap>
+#include <QPixmap>
+#include <QTextStream>
+#include <QHBoxLayout>
+#include <QVBoxLayout>
+#include <QWidget>
+#include <atomic>
+#include <cstdlib>
+#include <functional>
+#include <new>
+
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+#include <malloc.h>
+#define LABELSLIDER_BENCH_HEAP 1
+#endif
+
+// Headless benchmark suite for LabelSlider, run on the offscreen platform.
+// Each scenario runs once per label render mode and prints one CSV row:
+//
+//   scenario,mode,param,iterations,total_ms,per_iter_us,allocs,heap_bytes,objects
+//
+// allocs counts heap allocations: every malloc, calloc and realloc on glibc,
+// which includes QString and QVector payloads, and only operator new calls
+// elsewhere. heap_bytes is the change in heap in use
+// (-1 where mallinfo2() is unavailable) and objects the QObjects left alive
+// under the scenario's root widget.
+//
+//   labelslider_bench [--scenario construct,rebuild,...] [--sliders N] [--max-ticks N] [--quick]
+//                     [--trace file.json]
+
+namespace
+{
+std::atomic<qint64> g_allocations{0};
+}
+
+#ifdef __GLIBC__
+// Qt allocates string and container data with malloc() directly, so on glibc
+// the C allocator itself is interposed; operator new lands here as well.
+extern "C"
+{
+void *__libc_malloc(std::size_t size);
+void *__libc_calloc(std::size_t count, std::size_t size);
+void *__libc_realloc(void *p, std::size_t size);
+
+void *malloc(std::size_t size)
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_malloc(size);
+}
+
+void *calloc(std::size_t count, std::size_t size)
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_calloc(count, size);
+}
+
+void *realloc(void *p, std::size_t size)
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_realloc(p, size);
+}
+}
+#endif
+
+void *operator new(std::size_t size)
+{
+#ifndef __GLIBC__
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+#endif
+    if (void *p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+namespace
+{
+qint64 heapInUse()
+{
+#ifdef LABELSLIDER_BENCH_HEAP
+    return static_cast<qint64>(mallinfo2().uordblks);
+#else
+    return -1;
+#endif
+}
+
+void flush()
+{
+    // Label rebuilds are queued for the next event-loop pass.
+    QCoreApplication::sendPostedEvents();
+    QCoreApplication::processEvents();
+}
+
+struct Options
+{
+    QStringList scenarios;
+    int sliders = 200;
+    int maxTicks = 100000;
+};
+
+class Report
+{
+  public:
+    explicit Report(QTextStream &out) : m_out(out)
+    {
+        m_out << "scenario,mode,param,iterations,total_ms,per_iter_us,allocs,heap_bytes,objects\n";
+    }
+
+    // Runs body(iterations) between two probes of time, allocations and heap.
+    void measure(const char *scenario, LabelSlider::LabelRenderMode mode, const QString &param, int iterations,
+                 QWidget *root, const std::function<void(int)> &body)
+    {
+        const qint64 heapBefore = heapInUse();
+        const qint64 allocsBefore = g_allocations.load(std::memory_order_relaxed);
+        QElapsedTimer timer;
+        timer.start();
+
+        body(iterations);
+
+        const double totalMs = timer.nsecsElapsed() / 1e6;
+        const qint64 allocs = g_allocations.load(std::memory_order_relaxed) - allocsBefore;
+        const qint64 heap = heapBefore >= 0 ? heapInUse() - heapBefore : -1;
+        const int objects = root ? root->findChildren<QObject *>().size() : 0;
+
+        m_out << scenario << ',' << (mode == LabelSlider::WidgetLabels ? "WidgetLabels" : "PaintedLabels") << ','
+              << param << ',' << iterations << ',' << totalMs << ',' << totalMs * 1000.0 / qMax(1, iterations) << ','
+              << allocs << ',' << heap << ',' << objects << '\n';
+        m_out.flush();
+    }
+
+  private:
+    QTextStream &m_out;
+};
+
+LabelSlider *makeSlider(QWidget *parent, LabelSlider::LabelRenderMode mode, int ticks)
+{
+    LabelSlider *slider = new LabelSlider(Qt::Horizontal, parent);
+    slider->setLabelRenderMode(mode);
+    slider->setRange(0, ticks * 10);
+    slider->setTickInterval(10);
+    slider->setTickPosition(QSlider::TicksBothSides);
+    slider->setTickValuesVisible(true);
+    slider->setFormatType(LabelSlider::SimpleFormat);
+    slider->setFormatSuffix("dB");
+    return slider;
+}
+
+// Building and showing a panel of N sliders with 20 ticks each.
+void benchConstruct(Report &report, LabelSlider::LabelRenderMode mode, const Options &options)
+{
+    QWidget *panel = new QWidget;
+    QVBoxLayout *layout = new QVBoxLayout(panel);
+    report.measure("construct", mode, QString::number(options.sliders), options.sliders, panel, [&](int n) {
+        for (int i = 0; i < n; ++i)
+        {
+            layout->addWidget(makeSlider(panel, mode, 20));
+        }
+        panel->resize(1600, n * 60);
+        panel->show();
+        flush();
+    });
+
+    // Painting the finished panel, as in the original render mode comparison.
+    report.measure("paint", mode, QString::number(options.sliders), 20, panel, [&](int n) {
+        for (int i = 0; i < n; ++i)
+        {
+            panel->grab();
+        }
+    });
+    delete panel;
+}
+
+// Full rebuilds of one slider: every iteration shifts the range by one so all
+// tick values change.
+void benchRebuild(Report &report, LabelSlider::LabelRenderMode mode, const Options &options)
+{
+    for (int ticks = 10; ticks <= options.maxTicks; ticks *= 10)
+    {
+        QWidget *root = new QWidget;
+        LabelSlider *slider = makeSlider(root, mode, ticks);
+        slider->setTickPosition(QSlider::TicksBelow);
+        slider->resize(1600, 60);
+        root->show();
+        flush();
+
+        const int iterations = qBound(3, 100000 / ticks, 200);
+        report.measure("rebuild", mode, QString::number(ticks), iterations, root, [&](int n) {
+            for (int i = 0; i < n; ++i)
+            {
+                const int shift = (i + 1) % 2;
+                slider->setRange(shift, ticks * 10 + shift);
+                flush();
+            }
+        });
+        delete root;
+    }
+}
+
+// A window being dragged to size: many small resizes, each followed by an
+// event-loop pass, with fixed and automatic tick intervals.
+void benchResize(Report &report, LabelSlider::LabelRenderMode mode, const Options &)
+{
+    for (bool autoInterval : {false, true})
+    {
+        QWidget *root = new QWidget;
+        LabelSlider *slider = makeSlider(root, mode, 100);
+        slider->setAutoTickInterval(autoInterval);
+        slider->resize(1600, 60);
+        root->show();
+        flush();
+
+        report.measure("resize", mode, autoInterval ? "auto" : "fixed", 400, root, [&](int n) {
+            for (int i = 0; i < n; ++i)
+            {
+                const int step = i % 200;
+                slider->resize(800 + 4 * (step < 100 ? step : 200 - step), 60);
+                flush();
+            }
+        });
+        delete root;
+    }
+}
+
+// Dragging the handle across the whole range one step at a time.
+void benchDrag(Report &report, LabelSlider::LabelRenderMode mode, const Options &)
+{
+    QWidget *root = new QWidget;
+    LabelSlider *slider = makeSlider(root, mode, 100);
+    slider->resize(1600, 60);
+    root->show();
+    flush();
+
+    // A receiver, as an application would have.
+    qint64 received = 0;
+    QObject::connect(slider, &LabelSlider::valueChanged, root, [&received](int value) { received += value; });
+
+    const int steps = slider->maximum() - slider->minimum();
+    report.measure("drag", mode, QString::number(steps), steps, root, [&](int n) {
+        slider->setSliderDown(true);
+        for (int i = 1; i <= n; ++i)
+        {
+            slider->setSliderPosition(slider->minimum() + i);
+            flush();
+        }
+        slider->setSliderDown(false);
+    });
+    delete root;
+}
+
+// Relabelling 200 ticks per side with each FormatType.
+void benchFormat(Report &report, LabelSlider::LabelRenderMode mode, const Options &)
+{
+    struct Case
+    {
+        const char *name;
+        LabelSlider::FormatType type;
+        std::function<void(LabelSlider *, int)> change;
+    };
+
+    QMap<int, QString> even;
+    QMap<int, QString> odd;
+    for (int v = 0; v <= 2000; v += 10)
+    {
+        even.insert(v, QString("L%1").arg(v));
+        odd.insert(v, QString("R%1").arg(v));
+    }
+
+    const Case cases[] = {
+        {"SimpleFormat", LabelSlider::SimpleFormat,
+         [](LabelSlider *s, int i) { s->setFormatSuffix(i % 2 ? " dB" : " Hz"); }},
+        {"PrefixSuffixFormat", LabelSlider::PrefixSuffixFormat,
+         [](LabelSlider *s, int i) { s->setFormatPrefixSuffix(i % 2 ? "$" : "EUR ", ""); }},
+        {"PrintfFormat", LabelSlider::PrintfFormat,
+         [](LabelSlider *s, int i) { s->setPrintfFormat(i % 2 ? "%+.1f dB" : "%.2f dB"); }},
+        {"CustomFunction", LabelSlider::CustomFunction,
+         [](LabelSlider *s, int i) {
+             const QString unit = i % 2 ? "ms" : "s";
+             s->setCustomFormatter([unit](int value) { return QString::number(value / 10) + unit; });
+         }},
+        {"CustomMapping", LabelSlider::CustomMapping,
+         [&](LabelSlider *s, int i) { s->setCustomLabels(i % 2 ? odd : even); }},
+    };
+
+    for (const Case &c : cases)
+    {
+        QWidget *root = new QWidget;
+        LabelSlider *slider = makeSlider(root, mode, 200);
+        slider->setFormatType(c.type);
+        c.change(slider, 0);
+        slider->resize(1600, 80);
+        root->show();
+        flush();
+
+        report.measure("format", mode, c.name, 100, root, [&](int n) {
+            for (int i = 1; i <= n; ++i)
+            {
+                c.change(slider, i);
+                flush();
+            }
+        });
+        delete root;
+    }
+}
+
+// The construct scenario as a mixing console: N vertical channels, once as a
+// row of LabelSliders and once as a single LabelSliderBank. The bank has no
+// render modes and paints its labels, so it reports under PaintedLabels.
+void benchBank(Report &report, LabelSlider::LabelRenderMode mode, const Options &options)
+{
+    QWidget *panel = new QWidget;
+    QHBoxLayout *layout = new QHBoxLayout(panel);
+    const QString param = QString::number(options.sliders);
+    if (mode == LabelSlider::WidgetLabels)
+    {
+        report.measure("bank", mode, param, options.sliders, panel, [&](int n) {
+            for (int i = 0; i < n; ++i)
+            {
+                LabelSlider *slider = new LabelSlider(Qt::Vertical, panel);
+                slider->setRange(-60, 12);
+                slider->setTickInterval(6);
+                slider->setTickPosition(i == 0 ? QSlider::TicksLeft : QSlider::NoTicks);
+                slider->setTickValuesVisible(i == 0);
+                slider->setFormatSuffix(" dB");
+                layout->addWidget(slider);
+            }
+            panel->resize(n * 30, 400);
+            panel->show();
+            flush();
+            panel->grab();
+        });
+    }
+    else
+    {
+        report.measure("bank", mode, param, options.sliders, panel, [&](int n) {
+            LabelSliderBank *bank = new LabelSliderBank(n, Qt::Vertical, panel);
+            bank->setRange(-60, 12);
+            bank->setTickInterval(6);
+            bank->setFormatSuffix(" dB");
+            layout->addWidget(bank);
+            panel->resize(n * 30, 400);
+            panel->show();
+            flush();
+            panel->grab();
+        });
+    }
+    delete panel;
+}
+
+// Recalling a preset of value, range and suffix on N shown sliders, flipping
+// between two presets; the time includes the one flush the recall queues.
+void benchPreset(Report &report, LabelSlider::LabelRenderMode mode, const Options &options)
+{
+    QWidget *panel = new QWidget;
+    QVBoxLayout *layout = new QVBoxLayout(panel);
+    LabelSliderGroup group;
+    for (int i = 0; i < options.sliders; ++i)
+    {
+        LabelSlider *slider = makeSlider(panel, mode, 20);
+        layout->addWidget(slider);
+        group.addSlider(slider);
+    }
+    panel->show();
+    flush();
+
+    const QByteArray first = group.saveState();
+    for (LabelSlider *slider : group.sliders())
+    {
+        slider->setRange(-100, 100);
+        slider->setValue(slider->value() + 7);
+        slider->setFormatSuffix("%");
+    }
+    const QByteArray second = group.saveState();
+    flush();
+
+    report.measure("preset", mode, QString::number(options.sliders), 20, panel, [&](int n) {
+        for (int i = 0; i < n; ++i)
+        {
+            group.restoreState(i % 2 ? second : first);
+            flush();
+        }
+    });
+    report.measure("preset-save", mode, QString::number(options.sliders), 20, panel, [&](int n) {
+        for (int i = 0; i < n; ++i)
+        {
+            group.saveState();
+        }
+    });
+    delete panel;
+}
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+
+    QApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("LabelSlider benchmark suite");
+    parser.addHelpOption();
+    const QCommandLineOption scenarioOption(
+        "scenario", "Comma-separated scenarios: construct, rebuild, resize, drag, format, bank, preset.", "names");
+    const QCommandLineOption slidersOption("sliders", "Sliders in the construct scenario.", "n", "200");
+    const QCommandLineOption ticksOption("max-ticks", "Largest tick count in the rebuild scenario.", "n", "100000");
+    const QCommandLineOption quickOption("quick", "Smaller sizes for a fast smoke run.");
+    const QCommandLineOption traceOption("trace", "Write a Chrome trace of the run (needs LABELSLIDER_TRACE).", "file");
+    parser.addOptions({scenarioOption, slidersOption, ticksOption, quickOption, traceOption});
+    parser.process(app);
+
+    Options options;
+    options.scenarios = parser.value(scenarioOption).split(',');
+    options.scenarios.removeAll(QString());
+    options.sliders = qMax(1, parser.value(slidersOption).toInt());
+    options.maxTicks = qMax(10, parser.value(ticksOption).toInt());
+    if (parser.isSet(quickOption))
+    {
+        options.sliders = qMin(options.sliders, 20);
+        options.maxTicks = qMin(options.maxTicks, 1000);
+    }
+
+    using Scenario = void (*)(Report &, LabelSlider::LabelRenderMode, const Options &);
+    const QList<QPair<QString, Scenario>> scenarios = {
+        {"construct", benchConstruct}, {"rebuild", benchRebuild}, {"resize", benchResize},
+        {"drag", benchDrag},           {"format", benchFormat},   {"bank", benchBank},
+        {"preset", benchPreset},
+    };
+
+    LabelSlider::setTracingEnabled(parser.isSet(traceOption));
+
+    QTextStream out(stdout);
+    Report report(out);
+    const LabelSlider::LabelRenderMode modes[] = {LabelSlider::WidgetLabels, LabelSlider::PaintedLabels};
+    for (const auto &scenario : scenarios)
+    {
+        if (!options.scenarios.isEmpty() && !options.scenarios.contains(scenario.first))
+            continue;
+        for (LabelSlider::LabelRenderMode mode : modes)
+        {
+            scenario.second(report, mode, options);
+        }
+    }
+
+    if (parser.isSet(traceOption) && !LabelSlider::saveChromeTrace(parser.value(traceOption)))
+    {
+        qWarning("labelslider_bench: cannot write %s", qPrintable(parser.value(traceOption)));
+        return 1;
+    }
+
+    return 0;
+}
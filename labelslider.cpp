@@ -1,525 +1,3648 @@
 #include "labelslider.h"
+#include <QCoreApplication>
+#include <QDataStream>
+#include <QElapsedTimer>
+#include <QFile>
 #include <QGridLayout>
+#include <QGuiApplication>
+#include <QHash>
+#include <QStylePainter>
+#include <QPaintEvent>
+#include <QMutex>
+#include <QPainter>
+#include <QScreen>
+#include <QStaticText>
 #include <QStyle>
 #include <QStyleOptionSlider>
+#include <QRunnable>
+#include <QThread>
+#include <QThreadPool>
+#include <QtAlgorithms>
 #include <QTimer>
+#include <QVector>
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cmath>
+#include <limits>
+#include <memory>
+
+#ifdef LABELSLIDER_TRACE
+namespace
+{
+// Completed spans go to a fixed ring. A writer claims a slot with a single
+// atomic increment and publishes it through the slot's sequence number, which
+// is odd while the slot is being written; readers skip slots that change under
+// them. Nothing is allocated and no lock is taken on either side.
+struct TraceEvent
+{
+    std::atomic<quint64> sequence{0};
+    const char *name = nullptr;
+    char object[32] = {};
+    qint64 start = 0;
+    qint64 duration = 0;
+    quintptr thread = 0;
+    int ticks = -1;
+};
+
+const int TraceCapacity = 8192;
+TraceEvent g_traceRing[TraceCapacity];
+std::atomic<quint64> g_traceHead{0};
+std::atomic<quint64> g_traceBegin{0};
+std::atomic<bool> g_traceEnabled{false};
+
+qint64 traceClock()
+{
+    static const QElapsedTimer clock = [] {
+        QElapsedTimer timer;
+        timer.start();
+        return timer;
+    }();
+    return clock.nsecsElapsed();
+}
+
+class TraceSpan
+{
+  public:
+    TraceSpan(const char *name, const QObject *object)
+        : m_name(g_traceEnabled.load(std::memory_order_relaxed) ? name : nullptr), m_object(object)
+    {
+        if (m_name)
+            m_start = traceClock();
+    }
+
+    ~TraceSpan()
+    {
+        if (m_name)
+            record();
+    }
+
+    void setTicks(int ticks)
+    {
+        m_ticks = ticks;
+    }
+
+  private:
+    void record() const
+    {
+        const qint64 end = traceClock();
+        const quint64 index = g_traceHead.fetch_add(1, std::memory_order_relaxed);
+        TraceEvent &event = g_traceRing[index % TraceCapacity];
+
+        event.sequence.store(2 * index + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        event.name = m_name;
+        event.start = m_start;
+        event.duration = end - m_start;
+        event.thread = reinterpret_cast<quintptr>(QThread::currentThreadId());
+        event.ticks = m_ticks;
+
+        // Keep a JSON-safe ASCII copy of the object name; the object may be
+        // gone by the time the trace is dumped.
+        const QString objectName = m_object ? m_object->objectName() : QString();
+        const int length = qMin(objectName.size(), int(sizeof(event.object)) - 1);
+        for (int i = 0; i < length; ++i)
+        {
+            const ushort c = objectName.at(i).unicode();
+            event.object[i] = (c >= 0x20 && c < 0x7f && c != '"' && c != '\\') ? char(c) : '_';
+        }
+        event.object[length] = 0;
+
+        event.sequence.store(2 * index + 2, std::memory_order_release);
+    }
+
+    const char *m_name;
+    const QObject *m_object;
+    qint64 m_start = 0;
+    int m_ticks = -1;
+};
+} // namespace
+
+#define LABELSLIDER_TRACE_SPAN(var, name, object) TraceSpan var(name, object)
+#define LABELSLIDER_TRACE_TICKS(var, ticks) var.setTicks(ticks)
+#else
+#define LABELSLIDER_TRACE_SPAN(var, name, object) static_cast<void>(0)
+#define LABELSLIDER_TRACE_TICKS(var, ticks) static_cast<void>(0)
+#endif
+
+// Side bar holding the tick labels of one side of the slider. Tick values,
+// texts, sizes and positions live in a flat item array in both render modes;
+// in WidgetLabels mode a parallel array holds one QLabel per item, while in
+// PaintedLabels mode the bar owns no child widgets and draws the items itself.
+class LabelSlider::TickBar : public QWidget
+{
+  public:
+    struct Item
+    {
+        qint64 value;
+        QString text;
+        QStaticText staticText;
+        QSize size;
+        QPoint pos;
+        bool pending = false; // showing a placeholder until an async result arrives
+    };
+
+    explicit TickBar(QWidget *parent) : QWidget(parent)
+    {
+        setAttribute(Qt::WA_TransparentForMouseEvents, true);
+    }
+
+    int labelCount() const
+    {
+        return items.size();
+    }
+
+    bool active = false;
+    bool alignEnd = false; // labels flush right, for a bar left of a vertical slider
+    QVector<Item> items;
+    QVector<QLabel *> labels;
+
+  protected:
+    void paintEvent(QPaintEvent *event) override
+    {
+        if (items.isEmpty() || !labels.isEmpty())
+            return;
+
+        QPainter painter(this);
+        const QRect dirty = event->rect();
+        for (const Item &item : items)
+        {
+            const QRect r(item.pos, item.size);
+            if (!r.intersects(dirty))
+                continue;
+            const QSizeF textSize = item.staticText.size();
+            painter.drawStaticText(QPointF(r.x() + (r.width() - textSize.width()) / 2,
+                                           r.y() + (r.height() - textSize.height()) / 2),
+                                   item.staticText);
+        }
+    }
+};
+
+// Latency from an input event reaching the inner slider to the value signal
+// it causes, and to the next completed paint of the slider. Samples go into
+// fixed log-scale histograms, so recording never allocates.
+class LabelSlider::LatencyProbe
+{
+  public:
+    LatencyProbe()
+    {
+        m_clock.start();
+    }
+
+    void beginInput()
+    {
+        m_inputTime = m_clock.nsecsElapsed();
+        m_signalled = false;
+    }
+
+    void endInput()
+    {
+        // Only inputs that changed the value wait for a paint.
+        if ((m_signalled || m_changed) && m_paintFrom < 0)
+            m_paintFrom = m_inputTime;
+        m_inputTime = -1;
+        m_changed = false;
+    }
+
+    // The input changed the value but the emission policy holds the signal
+    // back. The signal sample is taken when it is finally emitted, measured
+    // from the first input it carries.
+    void deferred()
+    {
+        if (m_inputTime < 0)
+            return;
+        m_changed = true;
+        if (m_deferredFrom < 0)
+            m_deferredFrom = m_inputTime;
+    }
+
+    void discardDeferred()
+    {
+        m_deferredFrom = -1;
+    }
+
+    void signalled()
+    {
+        qint64 from = m_deferredFrom;
+        if (from < 0 && m_inputTime >= 0 && !m_signalled)
+            from = m_inputTime;
+        if (from < 0)
+            return;
+        if (m_inputTime >= 0)
+            m_signalled = true;
+        m_deferredFrom = -1;
+        toSignal.add((m_clock.nsecsElapsed() - from) / 1000);
+    }
+
+    void painted()
+    {
+        if (m_paintFrom >= 0)
+        {
+            toPaint.add((m_clock.nsecsElapsed() - m_paintFrom) / 1000);
+            m_paintFrom = -1;
+        }
+    }
+
+    // Four buckets per power of two: exact below 4us, then at most 25% wide up
+    // to 2^30us, the last bucket catching everything above.
+    struct Histogram
+    {
+        enum
+        {
+            BucketCount = 120
+        };
+
+        quint32 buckets[BucketCount] = {};
+        qint64 samples = 0;
+        qint64 max = 0;
+
+        static int bucketOf(qint64 us)
+        {
+            if (us < 4)
+                return static_cast<int>(qMax<qint64>(0, us));
+            const int msb = 63 - qCountLeadingZeroBits(quint64(us));
+            const int index = 4 * (msb - 1) + static_cast<int>((us >> (msb - 2)) & 3);
+            return qMin(index, int(BucketCount) - 1);
+        }
+
+        static qint64 upperBound(int index)
+        {
+            if (index < 4)
+                return index;
+            const int msb = index / 4 + 1;
+            return (qint64(5 + index % 4) << (msb - 2)) - 1;
+        }
+
+        void add(qint64 us)
+        {
+            ++buckets[bucketOf(us)];
+            ++samples;
+            max = qMax(max, us);
+        }
+
+        qint64 percentile(double q) const
+        {
+            const qint64 rank = qMax<qint64>(1, qint64(std::ceil(q * samples)));
+            qint64 seen = 0;
+            for (int i = 0; i < BucketCount; ++i)
+            {
+                seen += buckets[i];
+                if (seen >= rank)
+                    return qMin(upperBound(i), max);
+            }
+            return max;
+        }
+
+        LatencyStats stats() const
+        {
+            LatencyStats result;
+            result.samples = samples;
+            if (samples > 0)
+            {
+                result.p50 = percentile(0.50);
+                result.p99 = percentile(0.99);
+                result.max = max;
+            }
+            return result;
+        }
+    };
+
+    Histogram toSignal;
+    Histogram toPaint;
+
+  private:
+    QElapsedTimer m_clock;
+    qint64 m_inputTime = -1;
+    qint64 m_paintFrom = -1;
+    qint64 m_deferredFrom = -1;
+    bool m_signalled = false;
+    bool m_changed = false;
+};
+
+// Process-wide display-rate tick shared by all sliders, in the manner of
+// requestAnimationFrame: a slider asks for the next frame and gets one
+// frameTick() call. The timer only runs while someone is waiting.
+class LabelSlider::FrameClock
+{
+  public:
+    static FrameClock &instance()
+    {
+        static FrameClock clock;
+        return clock;
+    }
+
+    void request(LabelSlider *slider)
+    {
+        m_pending.append(slider);
+        if (!m_timer)
+        {
+            m_timer = new QTimer;
+            m_timer->setTimerType(Qt::PreciseTimer);
+            QObject::connect(m_timer, &QTimer::timeout, [this]() { tick(); });
+            qAddPostRoutine([] {
+                FrameClock &clock = instance();
+                delete clock.m_timer;
+                clock.m_timer = nullptr;
+                clock.m_pending.clear();
+                clock.m_dormant.clear();
+            });
+        }
+        if (!m_timer->isActive())
+        {
+            const QScreen *screen = QGuiApplication::primaryScreen();
+            const qreal rate = screen && screen->refreshRate() > 1.0 ? screen->refreshRate() : 60.0;
+            m_timer->start(qMax(1, qRound(1000.0 / rate)));
+        }
+    }
+
+    void cancel(LabelSlider *slider)
+    {
+        m_pending.removeAll(slider);
+        m_dormant.removeAll(slider);
+        const int running = m_running.indexOf(slider);
+        if (running >= 0)
+            m_running[running] = nullptr;
+    }
+
+    // A bound slider whose value has stopped changing leaves the clock until
+    // a store from any thread posts a wake-up, which puts every sleeping
+    // slider back on it.
+    void sleep(LabelSlider *slider)
+    {
+        m_dormant.append(slider);
+    }
+
+    void wakeLater()
+    {
+        QCoreApplication::postEvent(&m_waker, new QEvent(QEvent::User));
+    }
+
+    // Milliseconds on a monotonic clock. During a tick this is the time the
+    // tick started, so every slider stepped in one frame sees the same time.
+    qint64 frameTime() const
+    {
+        return m_ticking ? m_frameTime : m_elapsed.elapsed();
+    }
+
+  private:
+    class Waker : public QObject
+    {
+      public:
+        bool event(QEvent *event) override
+        {
+            if (event->type() != QEvent::User)
+                return QObject::event(event);
+            FrameClock::instance().wake();
+            return true;
+        }
+    };
+
+    FrameClock()
+    {
+        m_elapsed.start();
+    }
+
+    void wake()
+    {
+        QVector<LabelSlider *> dormant;
+        dormant.swap(m_dormant);
+        for (LabelSlider *slider : dormant)
+        {
+            slider->m_bindingAsleep = false;
+            slider->requestFrame();
+        }
+    }
+
+    void tick()
+    {
+        m_frameTime = m_elapsed.elapsed();
+        m_ticking = true;
+        // Sliders asking again from frameTick() wait for the next frame.
+        m_running.swap(m_pending);
+        for (int i = 0; i < m_running.size(); ++i)
+        {
+            if (LabelSlider *slider = m_running.at(i))
+            {
+                slider->m_frameRequested = false;
+                slider->frameTick();
+            }
+        }
+        m_running.clear();
+        m_ticking = false;
+        if (m_pending.isEmpty() && m_timer)
+            m_timer->stop();
+    }
+
+    QTimer *m_timer = nullptr;
+    QElapsedTimer m_elapsed;
+    qint64 m_frameTime = 0;
+    bool m_ticking = false;
+    QVector<LabelSlider *> m_pending;
+    QVector<LabelSlider *> m_running;
+    QVector<LabelSlider *> m_dormant;
+    Waker m_waker;
+};
+
+// QSlider that can anchor its tick marks to a value other than its minimum.
+// In viewport mode the slider's range is the visible window, but tick marks
+// must stay on the grid of the full range so that they line up with labels.
+// Under a non-linear scale it draws the marks itself, at the labelled values.
+class LabelSlider::Slider : public QSlider
+{
+  public:
+    using QSlider::QSlider;
+
+    bool alignTicks = false;
+    qint64 tickOrigin = 0;
+    QVector<double> tickRatios;
+    LatencyProbe *latency = nullptr;
+
+  protected:
+    bool event(QEvent *event) override
+    {
+        if (!latency)
+            return QSlider::event(event);
+
+        switch (event->type())
+        {
+        case QEvent::MouseButtonPress:
+        case QEvent::MouseButtonRelease:
+        case QEvent::MouseMove:
+        case QEvent::Wheel:
+        case QEvent::KeyPress: {
+            // Signals caused by the input are emitted while QSlider handles it.
+            latency->beginInput();
+            const bool result = QSlider::event(event);
+            latency->endInput();
+            return result;
+        }
+        default:
+            return QSlider::event(event);
+        }
+    }
+
+    void paintEvent(QPaintEvent *event) override
+    {
+        paintSlider(event);
+        if (latency)
+            latency->painted();
+    }
+
+  private:
+    void paintSlider(QPaintEvent *event)
+    {
+        if (!tickRatios.isEmpty() && tickPosition() != NoTicks)
+        {
+            paintCurveTicks();
+            return;
+        }
+        if (!alignTicks || tickPosition() == NoTicks)
+        {
+            QSlider::paintEvent(event);
+            return;
+        }
+
+        QStylePainter painter(this);
+        QStyleOptionSlider opt;
+        initStyleOption(&opt);
+
+        const int interval = opt.tickInterval > 0 ? opt.tickInterval : opt.pageStep;
+        const qint64 span = qint64(opt.maximum) - opt.minimum;
+        qint64 lead = 0;
+        if (interval > 0)
+        {
+            qint64 offset = (qint64(opt.minimum) - tickOrigin) % interval;
+            if (offset < 0)
+                offset += interval;
+            lead = offset > 0 ? interval - offset : 0;
+        }
+
+        opt.subControls = QStyle::SC_SliderGroove | QStyle::SC_SliderHandle;
+        if (interval > 0 && lead == 0)
+        {
+            opt.subControls |= QStyle::SC_SliderTickmarks;
+        }
+        else if (interval > 0 && span > 0 && lead <= span && opt.maximum + lead <= INT_MAX)
+        {
+            // Let the style draw the ticks of a range shifted onto the grid, then
+            // move them back by the same amount along the groove.
+            const int available = style()->pixelMetric(QStyle::PM_SliderSpaceAvailable, &opt, this);
+            const int fudge = style()->pixelMetric(QStyle::PM_SliderLength, &opt, this) / 2;
+            int shift = QStyle::sliderPositionFromValue(0, static_cast<int>(qMin<qint64>(span, INT_MAX)),
+                                                        static_cast<int>(lead), available);
+            if (opt.upsideDown)
+                shift = -shift;
+
+            QStyleOptionSlider ticks = opt;
+            ticks.subControls = QStyle::SC_SliderTickmarks;
+            ticks.minimum = static_cast<int>(opt.minimum + lead);
+            ticks.maximum = static_cast<int>(opt.maximum + lead);
+
+            painter.save();
+            if (opt.orientation == Qt::Horizontal)
+            {
+                painter.setClipRect(QRect(fudge - 1, 0, available + 2, height()));
+                painter.translate(shift, 0);
+            }
+            else
+            {
+                painter.setClipRect(QRect(0, fudge - 1, width(), available + 2));
+                painter.translate(0, shift);
+            }
+            painter.drawComplexControl(QStyle::CC_Slider, ticks);
+            painter.restore();
+        }
+
+        painter.drawComplexControl(QStyle::CC_Slider, opt);
+    }
+
+    // Groove and handle from the style, marks where the style would put
+    // them, but at fractions of the groove instead of multiples of the interval.
+    void paintCurveTicks()
+    {
+        QStylePainter painter(this);
+        QStyleOptionSlider opt;
+        initStyleOption(&opt);
+        opt.subControls = QStyle::SC_SliderGroove | QStyle::SC_SliderHandle;
+        painter.drawComplexControl(QStyle::CC_Slider, opt);
+
+        const int tickOffset = style()->pixelMetric(QStyle::PM_SliderTickmarkOffset, &opt, this);
+        const int thickness = style()->pixelMetric(QStyle::PM_SliderControlThickness, &opt, this);
+        const int available = style()->pixelMetric(QStyle::PM_SliderSpaceAvailable, &opt, this);
+        const int fudge = style()->pixelMetric(QStyle::PM_SliderLength, &opt, this) / 2;
+        const bool above = opt.tickPosition & TicksAbove;
+        const bool below = opt.tickPosition & TicksBelow;
+
+        painter.setPen(opt.palette.color(QPalette::WindowText));
+        for (double ratio : tickRatios)
+        {
+            const int pos = fudge + qRound((opt.upsideDown ? 1.0 - ratio : ratio) * available);
+            if (opt.orientation == Qt::Horizontal)
+            {
+                if (above)
+                    painter.drawLine(pos, 0, pos, tickOffset - 2);
+                if (below)
+                    painter.drawLine(pos, tickOffset + thickness + 1, pos, height() - 1);
+            }
+            else
+            {
+                if (above)
+                    painter.drawLine(0, pos, tickOffset - 2, pos);
+                if (below)
+                    painter.drawLine(tickOffset + thickness + 1, pos, width() - 1, pos);
+            }
+        }
+    }
+};
+
+// Overlay covering the whole LabelSlider that draws the value bubble. It
+// never moves or resizes with the bubble, so a new value only repaints the
+// old and new bubble rectangles and never touches the layout.
+class LabelSlider::ValueBubble : public QWidget
+{
+  public:
+    explicit ValueBubble(QWidget *parent) : QWidget(parent)
+    {
+        setAttribute(Qt::WA_TransparentForMouseEvents);
+        setAttribute(Qt::WA_NoSystemBackground);
+        setFocusPolicy(Qt::NoFocus);
+    }
+
+    static const int padding = 3;
+
+    void setBubble(const QRect &rect, const QString &text, const QStaticText &staticText)
+    {
+        if (rect == bubbleRect && text == bubbleText)
+            return;
+        update(bubbleRect);
+        bubbleRect = rect;
+        bubbleText = text;
+        bubbleStaticText = staticText;
+        update(bubbleRect);
+    }
+
+  protected:
+    void paintEvent(QPaintEvent *) override
+    {
+        if (bubbleRect.isEmpty())
+            return;
+
+        QPainter painter(this);
+        painter.setRenderHint(QPainter::Antialiasing);
+        painter.setPen(palette().color(QPalette::Mid));
+        painter.setBrush(palette().toolTipBase());
+        painter.drawRoundedRect(QRectF(bubbleRect).adjusted(0.5, 0.5, -0.5, -0.5), padding, padding);
+        painter.setPen(palette().color(QPalette::ToolTipText));
+        painter.drawStaticText(bubbleRect.topLeft() + QPoint(padding, padding), bubbleStaticText);
+    }
+
+  private:
+    QRect bubbleRect;
+    QString bubbleText;
+    QStaticText bubbleStaticText;
+};
+
+namespace
+{
+// Label texts measured for one font, shared by all sliders of the process.
+// Identical texts are interned so that every slider showing "0 dB" holds the
+// same string and the same prepared QStaticText. Bounded by entry count; when
+// full, the less recently used half is dropped. GUI thread only.
+class LabelTextCache
+{
+  public:
+    // The size is measured, and the static text laid out, only for callers
+    // that paint the text themselves; a QLabel measures its own.
+    struct Entry
+    {
+        QString text;
+        QSize size;
+        QStaticText staticText;
+        quint64 used = 0;
+    };
+
+    struct Font
+    {
+        Font() : metrics(QFont())
+        {
+        }
+
+        QFont font;
+        QFontMetrics metrics;
+        QHash<QString, Entry> entries;
+    };
+
+    static LabelTextCache &instance()
+    {
+        static LabelTextCache cache;
+        return cache;
+    }
+
+    // Fonts and glyph runs must not outlive the application object.
+    LabelTextCache()
+    {
+        qAddPostRoutine([] {
+            LabelTextCache &cache = instance();
+            cache.clear(false);
+            qDeleteAll(cache.m_fonts);
+            cache.m_fonts.clear();
+        });
+    }
+
+    // Fonts are held by pointer, so the returned one stays put when the hash
+    // grows, and lives for the cache's lifetime; only entries are evicted.
+    Font *font(const QFont &font)
+    {
+        const QString key = font.key();
+        Font *&slot = m_fonts[key];
+        if (!slot)
+        {
+            slot = new Font;
+            slot->font = font;
+            slot->metrics = QFontMetrics(font);
+        }
+        return slot;
+    }
+
+    Entry lookup(Font *font, const QString &text, bool painted)
+    {
+        const auto it = font->entries.find(text);
+        if (it != font->entries.end())
+        {
+            ++m_stats.hits;
+            it->used = ++m_clock;
+            if (painted && !it->size.isValid())
+                measure(font, &it.value());
+            return it.value();
+        }
+
+        ++m_stats.misses;
+        if (m_stats.entries >= m_capacity)
+        {
+            evict(m_capacity / 2);
+            ++m_stats.evictions;
+        }
+
+        Entry entry;
+        entry.text = text;
+        entry.used = ++m_clock;
+        if (painted)
+            measure(font, &entry);
+        font->entries.insert(text, entry);
+
+        ++m_stats.entries;
+        m_stats.bytes += footprint(text);
+        return entry;
+    }
+
+    // Rough footprint: the entry, its hash node, the string and the glyph run
+    // of the static text.
+    static qint64 footprint(const QString &text)
+    {
+        return qint64(sizeof(Entry)) + 32 + text.size() * (qint64(sizeof(QChar)) + 16);
+    }
+
+    static void measure(const Font *font, Entry *entry)
+    {
+        entry->size = font->metrics.size(0, entry->text);
+        entry->staticText.setText(entry->text);
+        entry->staticText.setTextFormat(Qt::PlainText);
+        entry->staticText.prepare(QTransform(), font->font);
+    }
+
+    void clear(bool eviction)
+    {
+        for (Font *font : m_fonts)
+        {
+            font->entries.clear();
+        }
+        if (eviction)
+            ++m_stats.evictions;
+        m_stats.entries = 0;
+        m_stats.bytes = 0;
+    }
+
+    // Keeps the most recently used entries, so a working set a little larger
+    // than the capacity still mostly hits instead of starting over each time.
+    void evict(int keep)
+    {
+        QVector<quint64> stamps;
+        stamps.reserve(int(m_stats.entries));
+        for (const Font *font : m_fonts)
+        {
+            for (const Entry &entry : font->entries)
+                stamps.append(entry.used);
+        }
+        if (keep <= 0 || stamps.isEmpty())
+        {
+            clear(false);
+            return;
+        }
+        if (keep >= stamps.size())
+            return;
+        auto nth = stamps.end() - keep;
+        std::nth_element(stamps.begin(), nth, stamps.end());
+        const quint64 oldest = *nth;
+
+        m_stats.entries = 0;
+        m_stats.bytes = 0;
+        for (Font *font : m_fonts)
+        {
+            for (auto it = font->entries.begin(); it != font->entries.end();)
+            {
+                if (it->used < oldest)
+                {
+                    it = font->entries.erase(it);
+                    continue;
+                }
+                ++m_stats.entries;
+                m_stats.bytes += footprint(it->text);
+                ++it;
+            }
+        }
+    }
+
+    void setCapacity(int capacity)
+    {
+        m_capacity = qMax(1, capacity);
+        if (m_stats.entries > m_capacity)
+        {
+            evict(m_capacity);
+            ++m_stats.evictions;
+        }
+    }
+
+    LabelSlider::LabelCacheStats stats() const
+    {
+        return m_stats;
+    }
+
+  private:
+    QHash<QString, Font *> m_fonts;
+    LabelSlider::LabelCacheStats m_stats;
+    int m_capacity = 8192;
+    quint64 m_clock = 0;
+};
+
+// Labels formatted on the thread pool, posted back to the slider in batches.
+class AsyncLabelsEvent : public QEvent
+{
+  public:
+    explicit AsyncLabelsEvent(int generation) : QEvent(eventType()), generation(generation)
+    {
+    }
+
+    static QEvent::Type eventType()
+    {
+        static const QEvent::Type type = static_cast<QEvent::Type>(QEvent::registerEventType());
+        return type;
+    }
+
+    int generation;
+    bool bubble = false;
+    QVector<qint64> values;
+    QVector<QString> texts;
+};
+
+// Rotation of a label pool that lets entries already showing a tick value keep
+// it when the first visible tick moves by whole intervals, e.g. on a pan.
+int rotationToFirst(qint64 current, qint64 first, qint64 interval, int size)
+{
+    if (size < 2 || interval <= 0)
+        return 0;
+
+    const qint64 delta = first - current;
+    if (delta == 0 || delta % interval != 0)
+        return 0;
+
+    const qint64 steps = delta / interval;
+    if (steps >= size || -steps >= size)
+        return 0;
+
+    return static_cast<int>(steps > 0 ? steps : size + steps);
+}
+
+#if QT_VERSION < QT_VERSION_CHECK(5, 10, 0)
+using qsizetype = int;
+#endif
+
+// Fixed decimals beyond what a double can carry only add zeros; the limit also
+// bounds the text appendNumber() writes.
+const int maximumDecimalPlaces = 17;
+
+// saveState() data: magic, version and state count, then one record per
+// slider in a QDataStream.
+const quint32 stateMagic = 0x4c534c44;
+const quint8 stateVersion = 1;
+
+// Smallest encodings of a slider record, a CustomMapping point and a range,
+// with empty strings. Counts read back are checked against them before
+// anything is allocated.
+const qint64 minimumStateSize = 88;
+const qint64 minimumPointSize = 12;
+const qint64 minimumRangeSize = 20;
+
+// Inner slider positions of a non-linear scale; the table holds one value per
+// position.
+const int scaleResolution = 1000;
+
+double roundToSignificant(double value, int digits)
+{
+    if (value == 0.0 || !std::isfinite(value))
+        return value;
+    const double magnitude = std::pow(10.0, digits - 1 - std::floor(std::log10(std::fabs(value))));
+    return std::round(value * magnitude) / magnitude;
+}
+
+// Decimal digits of value written backwards from end, which needs room for
+// 20 digits and a sign; returns where they start.
+const char *integerDigits(qint64 value, char *end)
+{
+    quint64 magnitude = value < 0 ? 0 - quint64(value) : quint64(value);
+    char *p = end;
+    do
+    {
+        *--p = char('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude);
+    if (value < 0)
+        *--p = '-';
+    return p;
+}
+
+qint64 roundSaturated(double value)
+{
+    if (!(value > -9.2e18))
+        return value < 0.0 ? std::numeric_limits<qint64>::min() : 0;
+    if (value >= 9.2e18)
+        return std::numeric_limits<qint64>::max();
+    return std::llround(value);
+}
+
+int saturated(qint64 value)
+{
+    return static_cast<int>(qBound<qint64>(INT_MIN, value, INT_MAX));
+}
+} // namespace
+
+// Shared between a slider and its formatting jobs. Jobs check the generation
+// between values, so a newer request cancels older ones, and post their
+// results only while the slider is alive.
+struct LabelSlider::AsyncFormatState
+{
+    QMutex mutex;
+    LabelSlider *owner = nullptr;
+    std::atomic<int> generation{0};
+};
+
+class LabelSlider::FormatJob : public QRunnable
+{
+  public:
+    std::shared_ptr<AsyncFormatState> state;
+    int generation = 0;
+    bool bubble = false;
+    std::function<QString(int)> formatter;
+    std::function<QString(double)> formatterF;
+    QVector<qint64> values;
+    QVector<double> reals;
+
+    void run() override
+    {
+        AsyncLabelsEvent *result = new AsyncLabelsEvent(generation);
+        result->bubble = bubble;
+        result->values = values;
+        result->texts.reserve(values.size());
+        for (int i = 0; i < values.size(); ++i)
+        {
+            if (state->generation.load(std::memory_order_relaxed) != generation)
+            {
+                // The bubble's request always reports back, so that the
+                // slider knows it may ask again.
+                if (!bubble)
+                {
+                    delete result;
+                    return;
+                }
+                break;
+            }
+            result->texts.append(formatterF ? formatterF(reals.at(i)) : formatter(saturated(values.at(i))));
+        }
+
+        QMutexLocker lock(&state->mutex);
+        if (state->owner && (bubble || state->generation.load() == generation))
+            QCoreApplication::postEvent(state->owner, result);
+        else
+            delete result;
+    }
+};
+
+LabelSlider::LabelSlider(Qt::Orientation orientation, QWidget *parent) : QWidget(parent)
+{
+    m_slider = new Slider(orientation, this);
+
+    connect(m_slider, &QSlider::valueChanged, this, [this](int position) {
+        if (m_syncDepth > 0)
+            return;
+        // Input from the keyboard or the wheel takes over from an animation.
+        stopAnimation();
+        const qint64 value = valueFromSlider(position);
+        if (m_value != value)
+        {
+            m_value = value;
+            publishValue();
+            inputValueChanged();
+        }
+    });
+    connect(m_slider, &QSlider::sliderMoved, this, [this](int position) {
+        const qint64 value = valueFromSlider(position);
+        // Under a coalescing policy the sample waits for valueChanged, so it
+        // includes the delay the policy adds.
+        if (m_latency && m_emissionPolicy == EmitImmediately)
+            m_latency->signalled();
+        emit sliderMoved(saturated(value));
+        emit sliderMoved64(value);
+        emit sliderMovedF(realValue(value));
+    });
+    connect(m_slider, &QSlider::sliderPressed, this, [this]() {
+        stopAnimation();
+        emit sliderPressed();
+    });
+    connect(m_slider, &QSlider::sliderReleased, this, [this]() {
+        flushPendingEmission();
+        emit sliderReleased();
+    });
+    connect(m_slider, &QSlider::actionTriggered, this,
+            [this](int action) { emit actionTriggered(static_cast<QAbstractSlider::SliderAction>(action)); });
+
+    invalidate(DirtyStructure);
+}
+
+LabelSlider::LabelSlider(QWidget *parent) : QWidget(parent)
+{
+    m_slider = new Slider(this);
+
+    connect(m_slider, &QSlider::valueChanged, this, [this](int position) {
+        if (m_syncDepth > 0)
+            return;
+        // Input from the keyboard or the wheel takes over from an animation.
+        stopAnimation();
+        const qint64 value = valueFromSlider(position);
+        if (m_value != value)
+        {
+            m_value = value;
+            publishValue();
+            inputValueChanged();
+        }
+    });
+    connect(m_slider, &QSlider::sliderMoved, this, [this](int position) {
+        const qint64 value = valueFromSlider(position);
+        // Under a coalescing policy the sample waits for valueChanged, so it
+        // includes the delay the policy adds.
+        if (m_latency && m_emissionPolicy == EmitImmediately)
+            m_latency->signalled();
+        emit sliderMoved(saturated(value));
+        emit sliderMoved64(value);
+        emit sliderMovedF(realValue(value));
+    });
+    connect(m_slider, &QSlider::sliderPressed, this, [this]() {
+        stopAnimation();
+        emit sliderPressed();
+    });
+    connect(m_slider, &QSlider::sliderReleased, this, [this]() {
+        flushPendingEmission();
+        emit sliderReleased();
+    });
+    connect(m_slider, &QSlider::actionTriggered, this,
+            [this](int action) { emit actionTriggered(static_cast<QAbstractSlider::SliderAction>(action)); });
+
+    invalidate(DirtyStructure);
+}
+
+LabelSlider::~LabelSlider()
+{
+    if (m_asyncState)
+    {
+        QMutexLocker lock(&m_asyncState->mutex);
+        m_asyncState->owner = nullptr;
+        ++m_asyncState->generation;
+    }
+    if (m_frameRequested || m_bindingAsleep)
+        FrameClock::instance().cancel(this);
+    delete m_slider;
+    delete m_latency;
+}
+
+void LabelSlider::setTickPosition(QSlider::TickPosition position)
+{
+    m_slider->setTickPosition(position);
+    invalidate(DirtyStructure);
+}
+
+QSlider::TickPosition LabelSlider::tickPosition() const
+{
+    return m_slider->tickPosition();
+}
+
+void LabelSlider::setTickInterval(int ti)
+{
+    setTickInterval64(ti);
+}
+
+int LabelSlider::tickInterval() const
+{
+    return saturated(m_tickInterval);
+}
+
+void LabelSlider::setTickInterval64(qint64 ti)
+{
+    m_tickInterval = qMax<qint64>(0, ti);
+    m_slider->setTickInterval(sliderTickInterval(m_tickInterval));
+    invalidate(DirtyStructure);
+}
+
+qint64 LabelSlider::tickInterval64() const
+{
+    return m_tickInterval;
+}
+
+void LabelSlider::setTickIntervalF(double ti)
+{
+    // Round to whole resolution steps, but never down to no ticks at all.
+    const qint64 units = ti > 0.0 ? qMax<qint64>(1, qRound64(ti / m_resolution)) : 0;
+    setTickInterval64(units);
+}
+
+double LabelSlider::tickIntervalF() const
+{
+    return m_tickInterval * m_resolution;
+}
+
+void LabelSlider::setAutoTickInterval(bool enable)
+{
+    if (m_autoTickInterval != enable)
+    {
+        m_autoTickInterval = enable;
+        invalidate(DirtyStructure);
+    }
+}
+
+bool LabelSlider::autoTickInterval() const
+{
+    return m_autoTickInterval;
+}
+
+qint64 LabelSlider::labelInterval() const
+{
+    return m_labelInterval;
+}
+
+void LabelSlider::setOrientation(Qt::Orientation orientation)
+{
+    m_slider->setOrientation(orientation);
+    invalidate(DirtyStructure);
+}
+
+Qt::Orientation LabelSlider::orientation() const
+{
+    return m_slider->orientation();
+}
+
+void LabelSlider::setMinimum(int min)
+{
+    setRange64(min, qMax<qint64>(m_maximum, min));
+}
+
+int LabelSlider::minimum() const
+{
+    return saturated(m_minimum);
+}
+
+void LabelSlider::setMaximum(int max)
+{
+    setRange64(qMin<qint64>(m_minimum, max), max);
+}
+
+int LabelSlider::maximum() const
+{
+    return saturated(m_maximum);
+}
+
+void LabelSlider::setSingleStep(int step)
+{
+    m_slider->setSingleStep(step);
+}
+
+int LabelSlider::singleStep() const
+{
+    return m_slider->singleStep();
+}
+
+void LabelSlider::setPageStep(int step)
+{
+    m_slider->setPageStep(step);
+}
+
+int LabelSlider::pageStep() const
+{
+    return m_slider->pageStep();
+}
+
+void LabelSlider::setTracking(bool enable)
+{
+    m_slider->setTracking(enable);
+}
+
+bool LabelSlider::hasTracking() const
+{
+    return m_slider->hasTracking();
+}
+
+void LabelSlider::setSliderDown(bool down)
+{
+    m_slider->setSliderDown(down);
+}
+
+bool LabelSlider::isSliderDown() const
+{
+    return m_slider->isSliderDown();
+}
+
+void LabelSlider::setSliderPosition(int position)
+{
+    m_slider->setSliderPosition(sliderFromValue(position));
+}
+
+int LabelSlider::sliderPosition() const
+{
+    return saturated(valueFromSlider(m_slider->sliderPosition()));
+}
+
+void LabelSlider::setInvertedAppearance(bool inverted)
+{
+    m_slider->setInvertedAppearance(inverted);
+    invalidate(DirtyGeometry);
+}
+
+bool LabelSlider::invertedAppearance() const
+{
+    return m_slider->invertedAppearance();
+}
+
+void LabelSlider::setInvertedControls(bool inverted)
+{
+    m_slider->setInvertedControls(inverted);
+}
+
+bool LabelSlider::invertedControls() const
+{
+    return m_slider->invertedControls();
+}
+
+void LabelSlider::setValue(int v)
+{
+    setValue64(v);
+}
+
+int LabelSlider::value() const
+{
+    return saturated(m_value);
+}
+
+void LabelSlider::setValue64(qint64 v)
+{
+    const qint64 bounded = qBound(m_minimum, v, m_maximum);
+
+    // With an animation duration set, a new value glides in over the next
+    // frames. Hidden sliders and a handle the user is holding take it at once.
+    if (m_animationDuration > 0 && bounded != m_value && isVisible() && !m_slider->isSliderDown())
+    {
+        animateTo(bounded);
+        return;
+    }
+
+    if (placeValue(bounded))
+        emitValueChanged();
+    stopAnimation();
+}
+
+bool LabelSlider::placeValue(qint64 value)
+{
+    // The handle follows the value, or parks at the nearest edge when the value
+    // is outside the viewport. Either way the signals come from the caller, in
+    // every width, rather than from the inner slider.
+    ++m_syncDepth;
+    m_slider->setValue(sliderFromValue(value));
+    --m_syncDepth;
+
+    if (m_value == value)
+        return false;
+    m_value = value;
+    publishValue();
+    return true;
+}
+
+qint64 LabelSlider::value64() const
+{
+    return m_value;
+}
+
+void LabelSlider::setValueF(double v)
+{
+    if (!m_floatingPoint)
+    {
+        setValue64(qRound64(qBound<double>(m_minimum, v, m_maximum)));
+        return;
+    }
+
+    v = qBound(m_minimumF, v, m_maximumF);
+    const qint64 units = qBound(m_minimum, qRound64((v - m_minimumF) / m_resolution), m_maximum);
+    const double oldValue = valueF();
+
+    m_exactValid = true;
+    m_exactUnits = units;
+    m_exactValue = v;
+
+    if (units != m_value || m_animating)
+        setValue64(units);
+    else if (oldValue != v)
+        emit valueChangedF(v);
+}
+
+double LabelSlider::valueF() const
+{
+    if (m_floatingPoint && m_exactValid && m_exactUnits == m_value)
+        return m_exactValue;
+    return realValue(m_value);
+}
+
+double LabelSlider::realValue(qint64 units) const
+{
+    if (!m_floatingPoint)
+        return double(units);
+    if (units == m_maximum)
+        return m_maximumF;
+    return m_minimumF + units * m_resolution;
+}
+
+void LabelSlider::emitValueChanged()
+{
+    m_emitPending = false;
+    m_emittedValue = m_value;
+    if (m_emissionPolicy == EmitRateLimited || m_animationEmission == EmitRateLimited)
+        m_lastEmission.start();
+    if (m_latency)
+        m_latency->signalled();
+    emit valueChanged(saturated(m_value));
+    emit valueChanged64(m_value);
+    emit valueChangedF(valueF());
+}
+
+void LabelSlider::inputValueChanged()
+{
+    // Programmatic changes always emit at once; the policy only applies to
+    // changes coming from the user through the inner slider.
+    if (m_latency && m_emissionPolicy != EmitImmediately)
+        m_latency->deferred();
+    switch (m_emissionPolicy)
+    {
+    case EmitImmediately:
+        emitValueChanged();
+        return;
+    case EmitPerFrame:
+        m_emitPending = true;
+        requestFrame();
+        return;
+    case EmitRateLimited:
+        m_emitPending = true;
+        if (!m_lastEmission.isValid() || m_lastEmission.elapsed() >= 1000 / m_emissionRate)
+            flushPendingEmission();
+        else
+            requestFrame();
+        return;
+    case EmitOnRelease:
+        m_emitPending = true;
+        if (!m_slider->isSliderDown())
+            flushPendingEmission();
+        return;
+    }
+}
+
+void LabelSlider::flushPendingEmission()
+{
+    if (!m_emitPending)
+        return;
+    m_emitPending = false;
+    // A drag that came back to where it started changed nothing.
+    if (m_value != m_emittedValue)
+        emitValueChanged();
+    else if (m_latency)
+        m_latency->discardDeferred();
+}
+
+void LabelSlider::setEmissionPolicy(EmissionPolicy policy)
+{
+    if (m_emissionPolicy == policy)
+        return;
+    m_emissionPolicy = policy;
+    m_lastEmission.invalidate();
+    if (policy == EmitImmediately || (policy == EmitOnRelease && !m_slider->isSliderDown()))
+        flushPendingEmission();
+}
+
+LabelSlider::EmissionPolicy LabelSlider::emissionPolicy() const
+{
+    return m_emissionPolicy;
+}
+
+void LabelSlider::setEmissionRate(int hz)
+{
+    m_emissionRate = qBound(1, hz, 1000);
+}
+
+int LabelSlider::emissionRate() const
+{
+    return m_emissionRate;
+}
+
+void LabelSlider::requestFrame()
+{
+    if (!m_frameRequested)
+    {
+        m_frameRequested = true;
+        FrameClock::instance().request(this);
+    }
+}
+
+void LabelSlider::setAnimationDuration(int msecs)
+{
+    m_animationDuration = qMax(0, msecs);
+    // Switching animation off lands a glide in progress on its target.
+    if (m_animationDuration == 0 && m_animating)
+        setValue64(m_animationTo);
+}
+
+int LabelSlider::animationDuration() const
+{
+    return m_animationDuration;
+}
+
+void LabelSlider::setAnimationEasing(const QEasingCurve &easing)
+{
+    m_animationEasing = easing;
+}
+
+QEasingCurve LabelSlider::animationEasing() const
+{
+    return m_animationEasing;
+}
+
+void LabelSlider::setAnimationEmissionPolicy(EmissionPolicy policy)
+{
+    m_animationEmission = policy;
+}
+
+LabelSlider::EmissionPolicy LabelSlider::animationEmissionPolicy() const
+{
+    return m_animationEmission;
+}
+
+bool LabelSlider::isAnimating() const
+{
+    return m_animating;
+}
+
+void LabelSlider::stopAnimation()
+{
+    if (!m_animating)
+        return;
+    m_animating = false;
+    if (m_animationSilent)
+    {
+        m_animationSilent = false;
+        m_emittedValue = m_value;
+        return;
+    }
+    // Values the policy held back are reported where the handle stopped.
+    if (m_value != m_emittedValue)
+        emitValueChanged();
+}
+
+void LabelSlider::animateTo(qint64 value)
+{
+    if (m_animating && m_animationTo == value)
+        return;
+
+    // A new target mid-flight starts a fresh glide from where the handle is
+    // now, so the handle never jumps.
+    m_animating = true;
+    m_animationSilent = false;
+    m_animationFrom = m_value;
+    m_animationTo = value;
+    m_animationStart = FrameClock::instance().frameTime();
+    requestFrame();
+}
+
+void LabelSlider::stepAnimation()
+{
+    const qint64 elapsed = FrameClock::instance().frameTime() - m_animationStart;
+    const double progress = qBound(0.0, double(elapsed) / qMax(1, m_animationDuration), 1.0);
+
+    qint64 value = m_animationTo;
+    if (progress < 1.0)
+    {
+        // Curves that overshoot may leave the span between the two values,
+        // but never the range.
+        const double offset =
+            m_animationEasing.valueForProgress(progress) * (double(m_animationTo) - double(m_animationFrom));
+        value = m_animationFrom +
+                qBound(m_minimum - m_animationFrom, roundSaturated(offset), m_maximum - m_animationFrom);
+    }
+
+    if (placeValue(value) && !m_animationSilent)
+    {
+        switch (m_animationEmission)
+        {
+        case EmitImmediately:
+        case EmitPerFrame:
+            emitValueChanged();
+            break;
+        case EmitRateLimited:
+            if (!m_lastEmission.isValid() || m_lastEmission.elapsed() >= 1000 / m_emissionRate)
+                emitValueChanged();
+            break;
+        case EmitOnRelease:
+            break;
+        }
+    }
+
+    if (progress < 1.0)
+        requestFrame();
+    else
+        stopAnimation();
+}
+
+void LabelSlider::frameTick()
+{
+    // The bound value goes first: a store is a new target for the animation,
+    // and an echo of the last frame's value is dropped before it can stop it.
+    // Polling goes on only while stores keep coming; an idle binding sleeps
+    // until the next store, and a hidden slider until showEvent().
+    if (m_binding && isVisible())
+    {
+        if (applyBoundValue())
+            requestFrame();
+        else
+            sleepBinding();
+    }
+    if (m_animating)
+        stepAnimation();
+    if (m_emitPending)
+    {
+        if (m_emissionPolicy != EmitRateLimited || !m_lastEmission.isValid() ||
+            m_lastEmission.elapsed() >= 1000 / m_emissionRate)
+            flushPendingEmission();
+        else
+            requestFrame();
+    }
+}
+
+void LabelSlider::bindValue(std::shared_ptr<SharedValue> value)
+{
+    if (m_binding)
+        m_binding->m_idle.store(false);
+    m_binding = value;
+    if (m_binding)
+    {
+        publishValue();
+        requestFrame();
+    }
+}
+
+std::shared_ptr<LabelSlider::SharedValue> LabelSlider::boundValue() const
+{
+    return m_binding;
+}
+
+void LabelSlider::publishValue()
+{
+    if (m_binding)
+        m_binding->m_value.store(m_value, std::memory_order_release);
+}
+
+bool LabelSlider::applyBoundValue()
+{
+    // Stores since the last frame collapse into the newest one. A value
+    // handlers write back in response to valueChanged() equals the current
+    // one and is dropped here, so echoes end after one frame.
+    if (!m_binding->m_requested.exchange(false, std::memory_order_acquire))
+        return false;
+    const qint64 value = m_binding->m_request.load(std::memory_order_relaxed);
+    if (value == m_value)
+        return true;
+
+    // The hand on the handle wins over automation.
+    if (m_slider->isSliderDown())
+    {
+        publishValue();
+        return true;
+    }
+    setValue64(value);
+    return true;
+}
+
+void LabelSlider::sleepBinding()
+{
+    if (!m_bindingAsleep)
+    {
+        m_bindingAsleep = true;
+        FrameClock::instance().sleep(this);
+    }
+    // Raised after joining the sleepers, so a wake-up always finds the slider.
+    // A store that came in before the flag went up saw no sleeper and posted
+    // nothing, so it is taken up here.
+    m_binding->m_idle.store(true, std::memory_order_seq_cst);
+    if (m_binding->m_requested.load(std::memory_order_seq_cst) && m_binding->m_idle.exchange(false))
+        requestFrame();
+}
+
+void LabelSlider::SharedValue::wake()
+{
+    FrameClock::instance().wakeLater();
+}
+
+void LabelSlider::setTickValuesVisible(bool visible)
+{
+    if (m_showTickValues != visible)
+    {
+        m_showTickValues = visible;
+        invalidate(DirtyStructure);
+    }
+}
+
+bool LabelSlider::tickValuesVisible() const
+{
+    return m_showTickValues;
+}
+
+void LabelSlider::setRange(int min, int max)
+{
+    setRange64(min, max);
+}
+
+void LabelSlider::setRange64(qint64 min, qint64 max)
+{
+    const bool realChanged = m_floatingPoint;
+    m_floatingPoint = false;
+    m_resolution = 1.0;
+    applyRange(min, max, realChanged);
+}
+
+qint64 LabelSlider::minimum64() const
+{
+    return m_minimum;
+}
+
+qint64 LabelSlider::maximum64() const
+{
+    return m_maximum;
+}
+
+void LabelSlider::setRangeF(double min, double max, double resolution)
+{
+    if (!qIsFinite(min) || !qIsFinite(max))
+        return;
+    max = qMax(min, max);
+    if (!(resolution > 0.0))
+        resolution = max > min ? (max - min) / 10000.0 : 1.0;
+
+    // Keep the unit range well inside the exact integers of a double.
+    const double steps = std::ceil((max - min) / resolution - 1e-9);
+    const double maxSteps = double(Q_INT64_C(1) << 52);
+    if (steps > maxSteps)
+        resolution = (max - min) / maxSteps;
+
+    const bool realChanged = !m_floatingPoint || m_minimumF != min || m_maximumF != max || m_resolution != resolution;
+    m_floatingPoint = true;
+    m_minimumF = min;
+    m_maximumF = max;
+    m_resolution = resolution;
+    applyRange(0, static_cast<qint64>(qMin(steps, maxSteps)), realChanged);
+}
+
+double LabelSlider::minimumF() const
+{
+    return m_floatingPoint ? m_minimumF : double(m_minimum);
+}
+
+double LabelSlider::maximumF() const
+{
+    return m_floatingPoint ? m_maximumF : double(m_maximum);
+}
+
+double LabelSlider::resolution() const
+{
+    return m_resolution;
+}
+
+bool LabelSlider::isFloatingPoint() const
+{
+    return m_floatingPoint;
+}
+
+void LabelSlider::applyRange(qint64 min, qint64 max, bool realChanged)
+{
+    // A glide towards a value of the old range has nowhere sensible to land.
+    stopAnimation();
+    max = qMax(min, max);
+    // Every span in the model must fit a qint64.
+    if (min < 0 && max > min + std::numeric_limits<qint64>::max())
+        max = min + std::numeric_limits<qint64>::max();
+    const bool changed = realChanged || m_minimum != min || m_maximum != max;
+    const qint64 oldValue = m_value;
+    const double oldValueF = valueF();
+
+    m_minimum = min;
+    m_maximum = max;
+    m_value = qBound(min, m_value, max);
+    publishValue();
+    m_exactValid = false;
+    // Real values, and so label texts, hang off the floating-point range.
+    if (realChanged || m_floatingPoint)
+    {
+        if (m_asyncState)
+            ++m_asyncState->generation;
+        m_formatMemo.clear();
+    }
+    if (m_viewportActive)
+    {
+        m_viewMinimum = qBound(min, m_viewMinimum, max);
+        m_viewMaximum = qBound(m_viewMinimum, m_viewMaximum, max);
+        m_viewportActive = (m_viewMinimum != min || m_viewMaximum != max);
+    }
+    syncSlider();
+    invalidate(DirtyStructure);
+
+    if (changed)
+    {
+        emit rangeChanged(saturated(min), saturated(max));
+        emit rangeChanged64(min, max);
+        emit rangeChangedF(minimumF(), maximumF());
+    }
+    if (m_value != oldValue || valueF() != oldValueF)
+        emitValueChanged();
+}
+
+void LabelSlider::setViewport(qint64 first, qint64 last)
+{
+    first = qBound(m_minimum, first, m_maximum);
+    last = qBound(first, last, m_maximum);
+
+    const bool active = (first != m_minimum || last != m_maximum);
+    if (active == m_viewportActive && (!active || (first == m_viewMinimum && last == m_viewMaximum)))
+        return;
+
+    m_viewportActive = active;
+    m_viewMinimum = first;
+    m_viewMaximum = last;
+    syncSlider();
+    invalidate(DirtyStructure);
+
+    emit viewportChanged(first, last);
+}
+
+void LabelSlider::resetViewport()
+{
+    setViewport(m_minimum, m_maximum);
+}
+
+qint64 LabelSlider::viewportMinimum() const
+{
+    return m_viewportActive ? m_viewMinimum : m_minimum;
+}
+
+qint64 LabelSlider::viewportMaximum() const
+{
+    return m_viewportActive ? m_viewMaximum : m_maximum;
+}
+
+bool LabelSlider::hasViewport() const
+{
+    return m_viewportActive;
+}
+
+void LabelSlider::zoomViewport(double factor, qint64 anchor)
+{
+    const qint64 range = m_maximum - m_minimum;
+    if (factor <= 0.0 || range <= 0)
+        return;
 
-LabelSlider::LabelSlider(Qt::Orientation orientation, QWidget *parent) : QWidget(parent)
+    const qint64 lo = viewportMinimum();
+    const qint64 hi = viewportMaximum();
+    const qint64 span = hi - lo;
+    const qint64 newSpan = qBound<qint64>(1, qRound64(qMin(span / factor, double(range))), range);
+
+    // Keep the anchor at the same relative place in the window.
+    const qint64 pivot = qBound(lo, anchor, hi);
+    const double ratio = span > 0 ? double(pivot - lo) / span : 0.5;
+    const qint64 newLo = qBound<qint64>(m_minimum, pivot - qRound64(newSpan * ratio), m_maximum - newSpan);
+    setViewport(newLo, newLo + newSpan);
+}
+
+void LabelSlider::panViewport(qint64 delta)
+{
+    const qint64 lo = viewportMinimum();
+    const qint64 span = viewportMaximum() - lo;
+    // Compare against the room left before adding, so huge deltas cannot overflow.
+    qint64 newLo;
+    if (delta > m_maximum - span - lo)
+        newLo = m_maximum - span;
+    else if (delta < m_minimum - lo)
+        newLo = m_minimum;
+    else
+        newLo = lo + delta;
+    setViewport(newLo, newLo + span);
+}
+
+qint64 LabelSlider::valueFromSlider(int position) const
+{
+    if (!m_scaleTable.isEmpty())
+        return m_scaleTable.at(qBound(0, position, m_scaleTable.size() - 1));
+    if (m_sliderStride == 1)
+        return m_sliderBase + position;
+    const qint64 last = viewportMaximum();
+    const qint64 offset = qint64(position) * m_sliderStride;
+    return offset >= last - m_sliderBase ? last : m_sliderBase + offset;
+}
+
+int LabelSlider::sliderFromValue(qint64 value) const
+{
+    value = qBound(viewportMinimum(), value, viewportMaximum());
+    if (!m_scaleTable.isEmpty())
+        return qRound(scalePosition(value));
+    if (m_sliderStride == 1)
+        return static_cast<int>(value - m_sliderBase);
+    if (value == viewportMaximum())
+        return m_slider->maximum();
+    const qint64 offset = value - m_sliderBase;
+    return static_cast<int>((offset + m_sliderStride / 2) / m_sliderStride);
+}
+
+int LabelSlider::sliderTickInterval(qint64 interval) const
+{
+    if (interval <= 0)
+        return 0;
+    if (!m_scaleTable.isEmpty())
+    {
+        // Equal steps along the groove, as many as the interval gives values.
+        const qint64 span = qMax<qint64>(1, viewportMaximum() - viewportMinimum());
+        return static_cast<int>(qMax<qint64>(1, (m_scaleTable.size() - 1) / qMax<qint64>(1, span / interval)));
+    }
+    return saturated(qMax<qint64>(1, interval / m_sliderStride));
+}
+
+int LabelSlider::pixelOffset(qint64 value, int space, bool upsideDown) const
+{
+    if (!m_scaleTable.isEmpty())
+    {
+        const double ratio = scalePosition(value) / (m_scaleTable.size() - 1);
+        return qRound((upsideDown ? 1.0 - ratio : ratio) * space);
+    }
+    if (m_sliderStride == 1)
+    {
+        return QStyle::sliderPositionFromValue(m_slider->minimum(), m_slider->maximum(),
+                                               static_cast<int>(value - m_sliderBase), space, upsideDown);
+    }
+
+    const qint64 lo = viewportMinimum();
+    const double ratio = double(value - lo) / double(viewportMaximum() - lo);
+    return qRound((upsideDown ? 1.0 - ratio : ratio) * space);
+}
+
+void LabelSlider::syncSlider()
+{
+    // Range changes of the inner slider are internal; the value it may clamp to
+    // is only the handle position, the real value stays in m_value. Windows
+    // wider than an int are sampled every m_sliderStride values.
+    const qint64 lo = viewportMinimum();
+    const qint64 hi = viewportMaximum();
+    buildScaleTable(lo, hi);
+    if (!m_scaleTable.isEmpty())
+    {
+        m_sliderBase = 0;
+        m_sliderStride = 1;
+        ++m_syncDepth;
+        m_slider->setRange(0, m_scaleTable.size() - 1);
+        m_slider->setValue(sliderFromValue(m_value));
+        m_slider->setTickInterval(sliderTickInterval(m_drawnTickInterval ? m_drawnTickInterval : m_tickInterval));
+        --m_syncDepth;
+        return;
+    }
+
+    const quint64 span = quint64(hi) - quint64(lo);
+    if (lo >= INT_MIN && hi <= INT_MAX)
+    {
+        m_sliderBase = 0;
+        m_sliderStride = 1;
+    }
+    else
+    {
+        m_sliderBase = lo;
+        m_sliderStride = span <= quint64(INT_MAX) ? 1 : qint64(span / quint64(INT_MAX) + 1);
+    }
+
+    const quint64 positions = span / quint64(m_sliderStride) + (span % quint64(m_sliderStride) ? 1 : 0);
+    ++m_syncDepth;
+    m_slider->setRange(static_cast<int>(lo - m_sliderBase), static_cast<int>(lo - m_sliderBase + qint64(positions)));
+    m_slider->setValue(sliderFromValue(m_value));
+    m_slider->setTickInterval(sliderTickInterval(m_drawnTickInterval ? m_drawnTickInterval : m_tickInterval));
+    --m_syncDepth;
+}
+
+void LabelSlider::setScaleType(ScaleType type)
+{
+    if (m_scaleType == type)
+        return;
+    m_scaleType = type;
+    syncSlider();
+    invalidate(DirtyStructure);
+}
+
+LabelSlider::ScaleType LabelSlider::scaleType() const
+{
+    return m_scaleType;
+}
+
+void LabelSlider::setCustomScale(std::function<double(double)> curve)
+{
+    m_customScale = curve;
+    if (m_scaleType == CustomScale)
+    {
+        syncSlider();
+        invalidate(DirtyStructure);
+    }
+}
+
+void LabelSlider::buildScaleTable(qint64 lo, qint64 hi)
+{
+    m_scaleTable.clear();
+    if (m_scaleType == LinearScale || hi <= lo)
+        return;
+
+    // Curves work on real values; logarithms of ranges reaching zero or below
+    // are taken on a copy shifted to start at one.
+    const double loF = realValue(lo);
+    const double hiF = realValue(hi);
+    const double shift = loF > 0.0 ? 0.0 : 1.0 - loF;
+    const double ratio = (hiF + shift) / (loF + shift);
+    auto toUnits = [&](double real) {
+        const double units = m_floatingPoint ? (real - m_minimumF) / m_resolution : real;
+        return units <= double(lo) ? lo : units >= double(hi) ? hi : qint64(std::llround(units));
+    };
+
+    const int steps = static_cast<int>(qMin<qint64>(hi - lo, scaleResolution));
+    m_scaleTable.resize(steps + 1);
+    qint64 previous = lo;
+    for (int i = 0; i <= steps; ++i)
+    {
+        const double t = double(i) / steps;
+        double real;
+        if (m_scaleType == LogarithmicScale)
+            real = (loF + shift) * std::pow(ratio, t) - shift;
+        else
+            real = loF + (m_customScale ? qBound(0.0, m_customScale(t), 1.0) : t) * (hiF - loF);
+        previous = qMax(previous, toUnits(real));
+        m_scaleTable[i] = previous;
+    }
+    m_scaleTable[0] = lo;
+    m_scaleTable[steps] = hi;
+}
+
+double LabelSlider::scalePosition(qint64 value) const
+{
+    // Fractional table position of a value, interpolated between the two
+    // entries around it.
+    const auto it = std::lower_bound(m_scaleTable.constBegin(), m_scaleTable.constEnd(), value);
+    if (it == m_scaleTable.constBegin())
+        return 0.0;
+    if (it == m_scaleTable.constEnd())
+        return m_scaleTable.size() - 1;
+    const int index = static_cast<int>(it - m_scaleTable.constBegin());
+    const qint64 below = *(it - 1);
+    return index - 1 + double(value - below) / double(*it - below);
+}
+
+void LabelSlider::beginUpdate()
+{
+    ++m_updateDepth;
+}
+
+void LabelSlider::endUpdate()
+{
+    if (m_updateDepth > 0 && --m_updateDepth == 0 && m_dirty && m_grid)
+    {
+        scheduleFlush();
+    }
+}
+
+bool LabelSlider::isUpdating() const
+{
+    return m_updateDepth > 0;
+}
+
+void LabelSlider::setLabelRenderMode(LabelRenderMode mode)
+{
+    if (m_renderMode != mode)
+    {
+        m_renderMode = mode;
+        invalidate(DirtyStructure);
+    }
+}
+
+LabelSlider::LabelRenderMode LabelSlider::labelRenderMode() const
+{
+    return m_renderMode;
+}
+
+void LabelSlider::setValueIndicator(ValueIndicator indicator)
+{
+    if (m_valueIndicator == indicator)
+        return;
+    m_valueIndicator = indicator;
+
+    if (!m_bubble && indicator != NoValueIndicator)
+    {
+        m_bubble = new ValueBubble(this);
+        m_bubble->setGeometry(rect());
+        m_bubble->show();
+        connect(m_slider, &QSlider::valueChanged, this, &LabelSlider::updateValueBubble);
+        connect(m_slider, &QSlider::sliderMoved, this, &LabelSlider::updateValueBubble);
+        connect(m_slider, &QSlider::sliderPressed, this, &LabelSlider::updateValueBubble);
+        connect(m_slider, &QSlider::sliderReleased, this, &LabelSlider::updateValueBubble);
+    }
+    if (m_bubble)
+        updateValueBubble();
+}
+
+LabelSlider::ValueIndicator LabelSlider::valueIndicator() const
+{
+    return m_valueIndicator;
+}
+
+void LabelSlider::updateValueBubble()
+{
+    const bool shown = m_valueIndicator == ValueAlways ||
+                       (m_valueIndicator == ValueWhileDragging && m_slider->isSliderDown());
+    if (!shown)
+    {
+        m_bubble->setBubble(QRect(), QString(), QStaticText());
+        return;
+    }
+
+    // While dragging without tracking the handle runs ahead of the value.
+    const qint64 value = m_slider->isSliderDown() ? valueFromSlider(m_slider->sliderPosition()) : m_value;
+    QString text;
+    if (formatsAsync() && !m_formatMemo.contains(value))
+    {
+        text = QString(QChar(0x2026));
+        requestBubbleText(value);
+    }
+    else
+    {
+        text = formatValue(value);
+    }
+    LabelTextCache &cache = LabelTextCache::instance();
+    const LabelTextCache::Entry entry = cache.lookup(cache.font(m_bubble->font()), text, true);
+    const QSize size = entry.size + QSize(2 * ValueBubble::padding, 2 * ValueBubble::padding);
+
+    // Centred on the handle, on the leading side of the groove and inside the
+    // widget.
+    const GrooveGeometry &groove = grooveGeometry();
+    const int centre = groove.origin + pixelOffset(value, groove.space, groove.upsideDown);
+    const QPoint slider = m_slider->pos();
+    QPoint at;
+    if (m_slider->orientation() == Qt::Horizontal)
+    {
+        at.setX(qBound(0, slider.x() + centre - size.width() / 2, width() - size.width()));
+        at.setY(qMax(0, slider.y() - size.height()));
+    }
+    else
+    {
+        at.setX(qMax(0, slider.x() - size.width()));
+        at.setY(qBound(0, slider.y() + centre - size.height() / 2, height() - size.height()));
+    }
+
+    if (m_bubble->isHidden() || m_bubble->geometry() != rect())
+        m_bubble->setGeometry(rect());
+    m_bubble->raise();
+    m_bubble->setBubble(QRect(at, size), entry.text, entry.staticText);
+}
+
+LabelSlider::LabelCacheStats LabelSlider::labelCacheStats()
+{
+    return LabelTextCache::instance().stats();
+}
+
+void LabelSlider::setLabelCacheCapacity(int entries)
+{
+    LabelTextCache::instance().setCapacity(entries);
+}
+
+void LabelSlider::clearLabelCache()
+{
+    LabelTextCache::instance().clear(false);
+}
+
+void LabelSlider::setLatencyTracking(bool enable)
+{
+    if (enable == (m_latency != nullptr))
+        return;
+
+    if (enable)
+    {
+        m_latency = new LatencyProbe;
+    }
+    else
+    {
+        delete m_latency;
+        m_latency = nullptr;
+    }
+    m_slider->latency = m_latency;
+}
+
+bool LabelSlider::latencyTracking() const
+{
+    return m_latency != nullptr;
+}
+
+LabelSlider::LatencyStats LabelSlider::latencyStats(LatencyMeasure measure) const
+{
+    if (!m_latency)
+        return LatencyStats();
+    return (measure == InputToSignal ? m_latency->toSignal : m_latency->toPaint).stats();
+}
+
+void LabelSlider::resetLatencyStats()
+{
+    if (m_latency)
+    {
+        m_latency->toSignal = LatencyProbe::Histogram();
+        m_latency->toPaint = LatencyProbe::Histogram();
+    }
+}
+
+void LabelSlider::setTracingEnabled(bool enable)
+{
+#ifdef LABELSLIDER_TRACE
+    g_traceEnabled.store(enable, std::memory_order_relaxed);
+#else
+    Q_UNUSED(enable);
+#endif
+}
+
+bool LabelSlider::isTracingEnabled()
+{
+#ifdef LABELSLIDER_TRACE
+    return g_traceEnabled.load(std::memory_order_relaxed);
+#else
+    return false;
+#endif
+}
+
+void LabelSlider::clearTrace()
+{
+#ifdef LABELSLIDER_TRACE
+    g_traceBegin.store(g_traceHead.load(std::memory_order_acquire), std::memory_order_relaxed);
+#endif
+}
+
+QByteArray LabelSlider::chromeTrace()
+{
+    QByteArray json("{\"traceEvents\":[");
+#ifdef LABELSLIDER_TRACE
+    const quint64 head = g_traceHead.load(std::memory_order_acquire);
+    const quint64 begin = qMax(g_traceBegin.load(std::memory_order_relaxed),
+                               head > quint64(TraceCapacity) ? head - TraceCapacity : quint64(0));
+    const QByteArray pid = QByteArray::number(QCoreApplication::applicationPid());
+
+    bool first = true;
+    for (quint64 index = begin; index < head; ++index)
+    {
+        const TraceEvent &event = g_traceRing[index % TraceCapacity];
+        const quint64 published = 2 * index + 2;
+        if (event.sequence.load(std::memory_order_acquire) != published)
+            continue; // still being written, or already overwritten
+
+        const char *name = event.name;
+        const QByteArray object(event.object);
+        const qint64 start = event.start;
+        const qint64 duration = event.duration;
+        const quintptr thread = event.thread;
+        const int ticks = event.ticks;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (event.sequence.load(std::memory_order_relaxed) != published)
+            continue;
+
+        if (!first)
+            json += ',';
+        first = false;
+        json += "{\"name\":\"";
+        json += name;
+        json += "\",\"cat\":\"LabelSlider\",\"ph\":\"X\",\"ts\":";
+        json += QByteArray::number(start / 1000.0, 'f', 3);
+        json += ",\"dur\":";
+        json += QByteArray::number(duration / 1000.0, 'f', 3);
+        json += ",\"pid\":";
+        json += pid;
+        json += ",\"tid\":";
+        json += QByteArray::number(quint64(thread));
+        json += ",\"args\":{\"object\":\"";
+        json += object;
+        json += '"';
+        if (ticks >= 0)
+        {
+            json += ",\"ticks\":";
+            json += QByteArray::number(ticks);
+        }
+        json += "}}";
+    }
+#endif
+    json += "]}";
+    return json;
+}
+
+bool LabelSlider::saveChromeTrace(const QString &fileName)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return false;
+    return file.write(chromeTrace()) >= 0;
+}
+
+void LabelSlider::triggerAction(QSlider::SliderAction action)
+{
+    m_slider->triggerAction(action);
+}
+
+void LabelSlider::setFormatType(FormatType type)
+{
+    if (m_formatType != type)
+    {
+        m_formatType = type;
+        invalidateFormat();
+    }
+}
+
+LabelSlider::FormatType LabelSlider::formatType() const
+{
+    return m_formatType;
+}
+
+void LabelSlider::setFormatSuffix(const QString &suffix)
+{
+    if (m_formatSuffix != suffix)
+    {
+        m_formatSuffix = suffix;
+        if (m_formatType == SimpleFormat || m_formatType == PrefixSuffixFormat)
+        {
+            invalidateFormat();
+        }
+    }
+}
+
+QString LabelSlider::formatSuffix() const
+{
+    return m_formatSuffix;
+}
+
+void LabelSlider::setFormatPrefixSuffix(const QString &prefix, const QString &suffix)
+{
+    // SimpleFormat shows the suffix too, just not the prefix.
+    const bool suffixChanged = m_formatSuffix != suffix;
+    const bool changed = suffixChanged || m_formatPrefix != prefix;
+    m_formatPrefix = prefix;
+    m_formatSuffix = suffix;
+    if ((suffixChanged && m_formatType == SimpleFormat) || (changed && m_formatType == PrefixSuffixFormat))
+    {
+        invalidateFormat();
+    }
+}
+
+QString LabelSlider::formatPrefix() const
+{
+    return m_formatPrefix;
+}
+
+void LabelSlider::setPrintfFormat(const QString &format)
+{
+    if (m_printfFormat != format)
+    {
+        m_printfFormat = format;
+        m_printfSpec = compilePrintfFormat(format);
+        if (!m_printfSpec.valid)
+        {
+            qWarning("LabelSlider::setPrintfFormat: unsupported format \"%s\", falling back to plain numbers",
+                     qPrintable(format));
+        }
+        if (m_formatType == PrintfFormat)
+        {
+            invalidateFormat();
+        }
+    }
+}
+
+QString LabelSlider::printfFormat() const
+{
+    return m_printfFormat;
+}
+
+void LabelSlider::setDecimalPlaces(int places)
+{
+    places = qBound(0, places, maximumDecimalPlaces);
+    if (m_decimalPlaces != places)
+    {
+        m_decimalPlaces = places;
+        invalidateFormat();
+    }
+}
+
+int LabelSlider::decimalPlaces() const
+{
+    return m_decimalPlaces;
+}
+
+void LabelSlider::setValueScale(double scale)
+{
+    if (qAbs(m_valueScale - scale) > 1e-6)
+    {
+        m_valueScale = scale;
+        invalidateFormat();
+    }
+}
+
+double LabelSlider::valueScale() const
+{
+    return m_valueScale;
+}
+
+void LabelSlider::setCustomFormatter(std::function<QString(int)> formatter)
 {
-    m_slider = new QSlider(orientation, this);
+    m_customFormatter = formatter;
+    m_customFormatterF = nullptr;
+    if (m_formatType == CustomFunction)
+    {
+        invalidateFormat();
+    }
+}
 
-    connect(m_slider, &QSlider::valueChanged, this, [this](int value) { emit valueChanged(value); });
-    connect(m_slider, &QSlider::sliderMoved, this, [this](int position) { emit sliderMoved(position); });
-    connect(m_slider, &QSlider::sliderPressed, this, [this]() { emit sliderPressed(); });
-    connect(m_slider, &QSlider::sliderReleased, this, [this]() { emit sliderReleased(); });
-    connect(m_slider, &QSlider::rangeChanged, this, [this](int min, int max) { emit rangeChanged(min, max); });
-    connect(m_slider, &QSlider::actionTriggered, this,
-            [this](int action) { emit actionTriggered(static_cast<QAbstractSlider::SliderAction>(action)); });
+void LabelSlider::setCustomFormatterF(std::function<QString(double)> formatter)
+{
+    m_customFormatterF = formatter;
+    m_customFormatter = nullptr;
+    if (m_formatType == CustomFunction)
+    {
+        invalidateFormat();
+    }
+}
 
-    rebuildLabels();
+void LabelSlider::setCustomLabels(const QMap<int, QString> &labels)
+{
+    // QMap iterates in key order, so the table fills without sorting.
+    m_labelPoints.clear();
+    m_labelPoints.reserve(labels.size());
+    for (auto it = labels.constBegin(); it != labels.constEnd(); ++it)
+    {
+        m_labelPoints.append({it.key(), it.value()});
+    }
+    if (m_formatType == CustomMapping)
+    {
+        invalidateFormat();
+    }
 }
 
-LabelSlider::LabelSlider(QWidget *parent) : QWidget(parent)
+QMap<int, QString> LabelSlider::customLabels() const
 {
-    m_slider = new QSlider(this);
+    QMap<int, QString> labels;
+    for (const MappedLabel &point : m_labelPoints)
+    {
+        if (point.value == saturated(point.value))
+            labels.insert(static_cast<int>(point.value), point.text);
+    }
+    return labels;
+}
 
-    connect(m_slider, &QSlider::valueChanged, this, [this](int value) { emit valueChanged(value); });
-    connect(m_slider, &QSlider::sliderMoved, this, [this](int position) { emit sliderMoved(position); });
-    connect(m_slider, &QSlider::sliderPressed, this, [this]() { emit sliderPressed(); });
-    connect(m_slider, &QSlider::sliderReleased, this, [this]() { emit sliderReleased(); });
-    connect(m_slider, &QSlider::rangeChanged, this, [this](int min, int max) { emit rangeChanged(min, max); });
-    connect(m_slider, &QSlider::actionTriggered, this,
-            [this](int action) { emit actionTriggered(static_cast<QAbstractSlider::SliderAction>(action)); });
+void LabelSlider::setCustomLabel(int value, const QString &label)
+{
+    auto it = std::lower_bound(m_labelPoints.begin(), m_labelPoints.end(), qint64(value),
+                               [](const MappedLabel &point, qint64 v) { return point.value < v; });
+    if (it != m_labelPoints.end() && it->value == value)
+        it->text = label;
+    else
+        m_labelPoints.insert(it, {value, label});
 
-    rebuildLabels();
+    if (m_formatType == CustomMapping)
+    {
+        m_formatMemo.remove(value);
+        invalidateText(value);
+    }
 }
 
-LabelSlider::~LabelSlider()
+void LabelSlider::clearCustomLabels()
 {
-    delete m_slider;
-    qDeleteAll(m_labels);
+    m_labelPoints.clear();
+    m_labelRanges.clear();
+    if (m_formatType == CustomMapping)
+    {
+        invalidateFormat();
+    }
 }
 
-void LabelSlider::setTickPosition(QSlider::TickPosition position)
+void LabelSlider::setLabelRanges(const QVector<LabelRange> &ranges)
 {
-    m_slider->setTickPosition(position);
-    rebuildLabels();
+    m_labelRanges.clear();
+    m_labelRanges.reserve(ranges.size());
+
+    // The usual input is already sorted and disjoint and is taken as is;
+    // anything else is inserted one range at a time so that later entries
+    // win where they overlap.
+    bool ordered = true;
+    for (const LabelRange &range : ranges)
+    {
+        if (range.first >= range.last)
+            continue;
+        if (!m_labelRanges.isEmpty() && m_labelRanges.last().last > range.first)
+        {
+            ordered = false;
+            break;
+        }
+        m_labelRanges.append(range);
+    }
+    if (!ordered)
+    {
+        m_labelRanges.clear();
+        for (const LabelRange &range : ranges)
+        {
+            insertLabelRange(range);
+        }
+    }
+
+    if (m_formatType == CustomMapping)
+    {
+        invalidateFormat();
+    }
 }
 
-QSlider::TickPosition LabelSlider::tickPosition() const
+QVector<LabelSlider::LabelRange> LabelSlider::labelRanges() const
 {
-    return m_slider->tickPosition();
+    return m_labelRanges;
 }
 
-void LabelSlider::setTickInterval(int ti)
+void LabelSlider::addLabelRange(qint64 first, qint64 last, const QString &label)
 {
-    m_slider->setTickInterval(ti);
-    rebuildLabels();
+    if (first >= last)
+        return;
+    insertLabelRange({first, last, label});
+    if (m_formatType == CustomMapping)
+    {
+        invalidateFormat();
+    }
 }
 
-int LabelSlider::tickInterval() const
+void LabelSlider::insertLabelRange(const LabelRange &range)
 {
-    return m_slider->tickInterval();
+    if (range.first >= range.last)
+        return;
+
+    // Ranges in the table are disjoint, so their ends are sorted as well.
+    const auto begin = std::upper_bound(m_labelRanges.begin(), m_labelRanges.end(), range.first,
+                                        [](qint64 v, const LabelRange &r) { return v < r.last; });
+    auto end = begin;
+    while (end != m_labelRanges.end() && end->first < range.last)
+        ++end;
+
+    // Whatever the new range overlaps is cut back to the parts outside it.
+    QVector<LabelRange> pieces;
+    if (begin != end && begin->first < range.first)
+        pieces.append({begin->first, range.first, begin->text});
+    pieces.append(range);
+    if (begin != end && (end - 1)->last > range.last)
+        pieces.append({range.last, (end - 1)->last, (end - 1)->text});
+
+    const int index = static_cast<int>(begin - m_labelRanges.begin());
+    m_labelRanges.remove(index, static_cast<int>(end - begin));
+    for (int i = 0; i < pieces.size(); ++i)
+    {
+        m_labelRanges.insert(index + i, pieces.at(i));
+    }
 }
 
-void LabelSlider::setOrientation(Qt::Orientation orientation)
+const QString *LabelSlider::mappedLabel(qint64 value) const
 {
-    m_slider->setOrientation(orientation);
-    rebuildLabels();
+    // Point labels take precedence over the range they fall in.
+    const auto point = std::lower_bound(m_labelPoints.constBegin(), m_labelPoints.constEnd(), value,
+                                        [](const MappedLabel &p, qint64 v) { return p.value < v; });
+    if (point != m_labelPoints.constEnd() && point->value == value)
+        return &point->text;
+
+    const auto range = std::upper_bound(m_labelRanges.constBegin(), m_labelRanges.constEnd(), value,
+                                        [](qint64 v, const LabelRange &r) { return v < r.last; });
+    if (range != m_labelRanges.constEnd() && range->first <= value)
+        return &range->text;
+    return nullptr;
 }
 
-Qt::Orientation LabelSlider::orientation() const
+QByteArray LabelSlider::saveState() const
 {
-    return m_slider->orientation();
+    return encodeStates({state()});
 }
 
-void LabelSlider::setMinimum(int min)
+bool LabelSlider::restoreState(const QByteArray &state)
 {
-    m_slider->setMinimum(min);
-    rebuildLabels();
+    QVector<State> states;
+    if (!decodeStates(state, &states) || states.size() != 1)
+        return false;
+    applyState(states.first());
+    return true;
 }
 
-int LabelSlider::minimum() const
+LabelSlider::State LabelSlider::state() const
 {
-    return m_slider->minimum();
+    State state;
+    state.floatingPoint = m_floatingPoint;
+    state.minimum = m_minimum;
+    state.maximum = m_maximum;
+    // A slider in mid-glide is recorded at the value it is heading for.
+    state.value = m_animating ? m_animationTo : m_value;
+    state.minimumF = m_minimumF;
+    state.maximumF = m_maximumF;
+    state.resolution = m_resolution;
+    state.exactValid = m_floatingPoint && m_exactValid && m_exactUnits == state.value;
+    state.exactValue = state.exactValid ? m_exactValue : 0.0;
+    state.viewportActive = m_viewportActive;
+    state.viewMinimum = m_viewMinimum;
+    state.viewMaximum = m_viewMaximum;
+    state.scaleType = m_scaleType;
+    state.singleStep = m_slider->singleStep();
+    state.pageStep = m_slider->pageStep();
+    state.tickPosition = m_slider->tickPosition();
+    // Any interval past the span draws the same single tick, so the saved one
+    // never exceeds span + 1 and restoreState() can bound it.
+    const qint64 span = m_maximum - m_minimum;
+    state.tickInterval = qMin(m_tickInterval, span < std::numeric_limits<qint64>::max() ? span + 1 : span);
+    state.autoTickInterval = m_autoTickInterval;
+    state.showTickValues = m_showTickValues;
+    state.formatType = m_formatType;
+    state.prefix = m_formatPrefix;
+    state.suffix = m_formatSuffix;
+    state.printfFormat = m_printfFormat;
+    state.decimalPlaces = m_decimalPlaces;
+    state.valueScale = m_valueScale;
+    state.labelPoints = m_labelPoints;
+    state.labelRanges = m_labelRanges;
+    return state;
 }
 
-void LabelSlider::setMaximum(int max)
+bool LabelSlider::applyState(const State &state, bool silent)
 {
-    m_slider->setMaximum(max);
-    rebuildLabels();
+    const bool wasFloatingPoint = m_floatingPoint;
+    const qint64 oldMinimum = m_minimum;
+    const qint64 oldMaximum = m_maximum;
+    const qint64 oldValue = m_animating ? m_animationTo : m_value;
+    const double oldMinimumF = minimumF();
+    const double oldMaximumF = maximumF();
+    const double oldValueF = valueF();
+
+    // Every setter below returns early or only marks dirty bits when nothing
+    // changes, so recalling a preset that differs in one value costs one
+    // setValue64().
+    beginUpdate();
+
+    setFormatType(FormatType(state.formatType));
+    setFormatSuffix(state.suffix);
+    setFormatPrefixSuffix(state.prefix, state.suffix);
+    setPrintfFormat(state.printfFormat);
+    setDecimalPlaces(state.decimalPlaces);
+    setValueScale(state.valueScale);
+
+    const bool pointsChanged =
+        state.labelPoints.size() != m_labelPoints.size() ||
+        !std::equal(m_labelPoints.constBegin(), m_labelPoints.constEnd(), state.labelPoints.constBegin(),
+                    [](const MappedLabel &a, const MappedLabel &b) { return a.value == b.value && a.text == b.text; });
+    const bool rangesChanged =
+        state.labelRanges.size() != m_labelRanges.size() ||
+        !std::equal(m_labelRanges.constBegin(), m_labelRanges.constEnd(), state.labelRanges.constBegin(),
+                    [](const LabelRange &a, const LabelRange &b) {
+                        return a.first == b.first && a.last == b.last && a.text == b.text;
+                    });
+    if (pointsChanged || rangesChanged)
+    {
+        m_labelPoints = state.labelPoints;
+        m_labelRanges = state.labelRanges;
+        if (m_formatType == CustomMapping)
+            invalidateFormat();
+    }
+
+    // A new range rebuilds the scale table anyway, so a new scale type rides
+    // along with it instead of building the table twice.
+    const bool rangeChanged =
+        state.floatingPoint
+            ? !m_floatingPoint || m_minimumF != state.minimumF || m_maximumF != state.maximumF ||
+                  m_resolution != state.resolution
+            : m_floatingPoint || m_minimum != state.minimum || m_maximum != state.maximum;
+    if (rangeChanged)
+    {
+        m_scaleType = ScaleType(state.scaleType);
+        if (state.floatingPoint)
+            setRangeF(state.minimumF, state.maximumF, state.resolution);
+        else
+            setRange64(state.minimum, state.maximum);
+    }
+    else
+    {
+        setScaleType(ScaleType(state.scaleType));
+    }
+    if (state.viewportActive)
+        setViewport(state.viewMinimum, state.viewMaximum);
+    else
+        resetViewport();
+
+    setSingleStep(state.singleStep);
+    setPageStep(state.pageStep);
+    if (tickPosition() != state.tickPosition)
+        setTickPosition(QSlider::TickPosition(state.tickPosition));
+    if (m_tickInterval != state.tickInterval)
+        setTickInterval64(state.tickInterval);
+    setAutoTickInterval(state.autoTickInterval);
+    setTickValuesVisible(state.showTickValues);
+
+    if (state.floatingPoint && state.exactValid)
+        setValueF(state.exactValue);
+    else
+        setValue64(state.value);
+    // A recall reported by one notification for the whole group keeps the
+    // glide it starts quiet as well, down to the value it lands on.
+    if (silent && m_animating)
+        m_animationSilent = true;
+
+    endUpdate();
+
+    // An animated recall counts as a change of value as soon as it starts.
+    const qint64 newValue = m_animating ? m_animationTo : m_value;
+    return m_floatingPoint != wasFloatingPoint || m_minimum != oldMinimum || m_maximum != oldMaximum ||
+           newValue != oldValue || minimumF() != oldMinimumF || maximumF() != oldMaximumF || valueF() != oldValueF;
 }
 
-int LabelSlider::maximum() const
+QByteArray LabelSlider::encodeStates(const QVector<State> &states)
 {
-    return m_slider->maximum();
+    QByteArray data;
+    QDataStream out(&data, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_5_6);
+    out << stateMagic << stateVersion << quint32(states.size());
+
+    // Fields that only matter in some modes are written only in those modes.
+    for (const State &state : states)
+    {
+        out << state.floatingPoint << state.minimum << state.maximum << state.value;
+        if (state.floatingPoint)
+        {
+            out << state.minimumF << state.maximumF << state.resolution << state.exactValid;
+            if (state.exactValid)
+                out << state.exactValue;
+        }
+        out << state.viewportActive;
+        if (state.viewportActive)
+            out << state.viewMinimum << state.viewMaximum;
+        out << state.scaleType << state.singleStep << state.pageStep << state.tickPosition << state.tickInterval
+            << state.autoTickInterval << state.showTickValues;
+        out << state.formatType << state.prefix << state.suffix << state.printfFormat << state.decimalPlaces
+            << state.valueScale;
+        out << quint32(state.labelPoints.size());
+        for (const MappedLabel &point : state.labelPoints)
+            out << point.value << point.text;
+        out << quint32(state.labelRanges.size());
+        for (const LabelRange &range : state.labelRanges)
+            out << range.first << range.last << range.text;
+    }
+    return data;
 }
 
-void LabelSlider::setSingleStep(int step)
+bool LabelSlider::decodeStates(const QByteArray &data, QVector<State> *states)
 {
-    m_slider->setSingleStep(step);
+    QDataStream in(data);
+    in.setVersion(QDataStream::Qt_5_6);
+    quint32 magic = 0;
+    quint8 version = 0;
+    quint32 count = 0;
+    in >> magic >> version >> count;
+    // Counts from corrupt data could ask for far more memory than the data
+    // could ever describe, so each one must fit the bytes left.
+    auto fits = [&in](quint32 n, qint64 size) { return qint64(n) <= in.device()->bytesAvailable() / size; };
+    if (in.status() != QDataStream::Ok || magic != stateMagic || version != stateVersion ||
+        !fits(count, minimumStateSize))
+        return false;
+
+    QVector<State> decoded(static_cast<int>(count));
+    for (State &state : decoded)
+    {
+        in >> state.floatingPoint >> state.minimum >> state.maximum >> state.value;
+        if (state.floatingPoint)
+        {
+            in >> state.minimumF >> state.maximumF >> state.resolution >> state.exactValid;
+            if (state.exactValid)
+                in >> state.exactValue;
+        }
+        in >> state.viewportActive;
+        if (state.viewportActive)
+            in >> state.viewMinimum >> state.viewMaximum;
+        in >> state.scaleType >> state.singleStep >> state.pageStep >> state.tickPosition >> state.tickInterval >>
+            state.autoTickInterval >> state.showTickValues;
+        in >> state.formatType >> state.prefix >> state.suffix >> state.printfFormat >> state.decimalPlaces >>
+            state.valueScale;
+
+        quint32 points = 0;
+        in >> points;
+        if (!fits(points, minimumPointSize))
+            return false;
+        state.labelPoints.resize(static_cast<int>(points));
+        for (MappedLabel &point : state.labelPoints)
+            in >> point.value >> point.text;
+        quint32 ranges = 0;
+        in >> ranges;
+        if (!fits(ranges, minimumRangeSize))
+            return false;
+        state.labelRanges.resize(static_cast<int>(ranges));
+        for (LabelRange &range : state.labelRanges)
+            in >> range.first >> range.last >> range.text;
+
+        if (in.status() != QDataStream::Ok)
+            return false;
+
+        // Nothing that the setters would not have produced gets through.
+        const bool valid =
+            state.minimum <= state.maximum &&
+            (state.minimum >= 0 || state.maximum <= state.minimum + std::numeric_limits<qint64>::max()) &&
+            state.value >= state.minimum && state.value <= state.maximum &&
+            (!state.viewportActive ||
+             (state.minimum <= state.viewMinimum && state.viewMinimum <= state.viewMaximum &&
+              state.viewMaximum <= state.maximum)) &&
+            (!state.floatingPoint ||
+             (qIsFinite(state.minimumF) && qIsFinite(state.maximumF) && state.minimumF <= state.maximumF &&
+              qIsFinite(state.resolution) && state.resolution > 0.0 &&
+              (!state.exactValid || qIsFinite(state.exactValue)))) &&
+            state.singleStep >= 0 && state.pageStep >= 0 &&
+            state.scaleType >= LinearScale && state.scaleType <= CustomScale && state.tickPosition >= QSlider::NoTicks &&
+            state.tickPosition <= QSlider::TicksBothSides && state.tickInterval >= 0 &&
+            state.tickInterval - 1 <= state.maximum - state.minimum && state.formatType >= SimpleFormat &&
+            state.formatType <= CustomMapping && state.decimalPlaces >= 0 &&
+            state.decimalPlaces <= maximumDecimalPlaces && qIsFinite(state.valueScale) &&
+            std::adjacent_find(state.labelPoints.constBegin(), state.labelPoints.constEnd(),
+                               [](const MappedLabel &a, const MappedLabel &b) { return a.value >= b.value; }) ==
+                state.labelPoints.constEnd() &&
+            std::find_if(state.labelRanges.constBegin(), state.labelRanges.constEnd(),
+                         [](const LabelRange &r) { return r.first >= r.last; }) == state.labelRanges.constEnd() &&
+            std::adjacent_find(state.labelRanges.constBegin(), state.labelRanges.constEnd(),
+                               [](const LabelRange &a, const LabelRange &b) { return a.last > b.first; }) ==
+                state.labelRanges.constEnd();
+        if (!valid)
+            return false;
+    }
+    if (!in.atEnd())
+        return false;
+
+    states->swap(decoded);
+    return true;
 }
 
-int LabelSlider::singleStep() const
+QString LabelSlider::valueText() const
 {
-    return m_slider->singleStep();
+    return formatValue(m_value);
 }
 
-void LabelSlider::setPageStep(int step)
+QString LabelSlider::valueText(qint64 value) const
 {
-    m_slider->setPageStep(step);
+    return formatValue(value);
 }
 
-int LabelSlider::pageStep() const
+QString LabelSlider::formatValue(qint64 value) const
 {
-    return m_slider->pageStep();
+    // Memoised per slider until the format configuration changes, so a value
+    // labelled on both sides, or read back by a live readout, formats once.
+    const auto it = m_formatMemo.constFind(value);
+    if (it != m_formatMemo.constEnd())
+        return it.value();
+
+    const QString text = formatText(value);
+    if (m_formatMemo.size() >= 4096)
+        m_formatMemo.clear();
+    m_formatMemo.insert(value, text);
+    return text;
 }
 
-void LabelSlider::setTracking(bool enable)
+void LabelSlider::appendNumber(QString &out, qint64 value) const
 {
-    m_slider->setTracking(enable);
+    const bool exact = !m_floatingPoint && m_valueScale == 1.0;
+    if (!exact && (m_floatingPoint || m_decimalPlaces > 0))
+    {
+        const double scaled = realValue(value) * m_valueScale;
+        out += m_decimalPlaces > 0 ? QString::number(scaled, 'f', m_decimalPlaces) : QString::number(scaled);
+        return;
+    }
+
+    // Integers, including unscaled ones with fixed decimals, never go through
+    // a double or a temporary string.
+    char buffer[24];
+    char *end = buffer + sizeof(buffer);
+    const char *begin = integerDigits(exact ? value : static_cast<qint64>(realValue(value) * m_valueScale), end);
+    out += QLatin1String(begin, static_cast<int>(end - begin));
+    if (m_decimalPlaces > 0)
+    {
+        const qsizetype at = out.size();
+        const qsizetype places = m_decimalPlaces;
+        out.resize(at + 1 + places);
+        QChar *data = out.data() + at;
+        data[0] = QLatin1Char('.');
+        std::fill(data + 1, data + 1 + places, QLatin1Char('0'));
+    }
 }
 
-bool LabelSlider::hasTracking() const
+QString LabelSlider::formatText(qint64 value) const
 {
-    return m_slider->hasTracking();
+    // Labels come from the true value: exact integers in the integer model,
+    // the real value in floating-point mode.
+    const double real = realValue(value);
+    const bool exact = !m_floatingPoint && m_valueScale == 1.0;
+
+    switch (m_formatType)
+    {
+    case SimpleFormat:
+    case PrefixSuffixFormat: {
+        // Built in one string, sized up front.
+        const bool prefixed = m_formatType == PrefixSuffixFormat;
+        QString result;
+        result.reserve((prefixed ? m_formatPrefix.size() : 0) + 24 + m_decimalPlaces + m_formatSuffix.size());
+        if (prefixed)
+            result += m_formatPrefix;
+        appendNumber(result, value);
+        result += m_formatSuffix;
+        return result;
+    }
+
+    case PrintfFormat: {
+        const double scaledValue = real * m_valueScale;
+        const qint64 integral = exact ? value : static_cast<qint64>(scaledValue);
+        const PrintfSpec &spec = m_printfSpec;
+        if (!spec.valid)
+        {
+            return QString::number(integral);
+        }
+
+        QString number;
+        if (spec.conversion.isEmpty())
+        {
+            // Literal text only, no value to insert.
+        }
+        else if (spec.floating)
+        {
+            number = spec.plain ? QString::number(scaledValue, spec.type, spec.precision < 0 ? 6 : spec.precision)
+                                : QString::asprintf(spec.conversion.constData(), scaledValue);
+        }
+        else
+        {
+            number = spec.plain ? QString::number(integral)
+                                : QString::asprintf(spec.conversion.constData(), static_cast<qlonglong>(integral));
+        }
+
+        if (spec.prefix.isEmpty() && spec.suffix.isEmpty())
+            return number;
+
+        QString result;
+        result.reserve(spec.prefix.size() + number.size() + spec.suffix.size());
+        result += spec.prefix;
+        result += number;
+        result += spec.suffix;
+        return result;
+    }
+
+    case CustomFunction: {
+        LABELSLIDER_TRACE_SPAN(trace, "customFormatter", this);
+        if (m_customFormatterF)
+        {
+            return m_customFormatterF(real);
+        }
+        if (m_customFormatter)
+        {
+            return m_customFormatter(saturated(value));
+        }
+        return QString::number(value);
+    }
+
+    case CustomMapping:
+        if (const QString *label = mappedLabel(value))
+            return *label;
+        if (m_floatingPoint)
+            return QString::number(real * m_valueScale);
+        return QString::number(exact ? value : static_cast<qint64>(real * m_valueScale));
+    }
+
+    return QString::number(value);
 }
 
-void LabelSlider::setSliderDown(bool down)
+LabelSlider::PrintfSpec LabelSlider::compilePrintfFormat(const QString &format)
 {
-    m_slider->setSliderDown(down);
+    PrintfSpec spec;
+    QString *literal = &spec.prefix;
+    const int n = format.size();
+
+    for (int i = 0; i < n; ++i)
+    {
+        const ushort c = format.at(i).unicode();
+        if (c != '%')
+        {
+            literal->append(format.at(i));
+            continue;
+        }
+        if (i + 1 < n && format.at(i + 1).unicode() == '%')
+        {
+            literal->append(format.at(i));
+            ++i;
+            continue;
+        }
+        if (!spec.conversion.isEmpty())
+        {
+            return PrintfSpec(); // more than one conversion
+        }
+
+        // %[flags][width][.precision]type, with bounded width and precision and
+        // only the int and double conversions formatValue() can supply.
+        QByteArray conversion("%");
+        int j = i + 1;
+        auto at = [&](int k) -> ushort { return k < n ? format.at(k).unicode() : 0; };
+        bool plain = true;
+
+        while (at(j) == '-' || at(j) == '+' || at(j) == ' ' || at(j) == '#' || at(j) == '0')
+        {
+            conversion += static_cast<char>(at(j++));
+            plain = false;
+        }
+        for (int digits = 0; at(j) >= '0' && at(j) <= '9'; ++digits)
+        {
+            if (digits == 2)
+                return PrintfSpec();
+            conversion += static_cast<char>(at(j++));
+            plain = false;
+        }
+        if (at(j) == '.')
+        {
+            conversion += static_cast<char>(at(j++));
+            spec.precision = 0;
+            for (int digits = 0; at(j) >= '0' && at(j) <= '9'; ++digits)
+            {
+                if (digits == 2)
+                    return PrintfSpec();
+                spec.precision = spec.precision * 10 + (at(j) - '0');
+                conversion += static_cast<char>(at(j++));
+            }
+        }
+
+        const ushort type = at(j);
+        if (type == 'd' || type == 'i' || type == 'o' || type == 'u' || type == 'x' || type == 'X')
+        {
+            spec.floating = false;
+            plain = plain && spec.precision < 0 && (type == 'd' || type == 'i');
+        }
+        else if (type == 'f' || type == 'F' || type == 'e' || type == 'E' || type == 'g' || type == 'G')
+        {
+            spec.floating = true;
+            plain = plain && type != 'F' && !((type == 'g' || type == 'G') && spec.precision == 0);
+        }
+        else
+        {
+            return PrintfSpec(); // %s, %n, %p, length modifiers, '*' and friends
+        }
+
+        // Integers are always passed as qint64.
+        if (!spec.floating)
+            conversion += "ll";
+        conversion += static_cast<char>(type);
+        spec.conversion = conversion;
+        spec.type = static_cast<char>(type);
+        spec.plain = plain;
+        literal = &spec.suffix;
+        i = j;
+    }
+
+    spec.valid = true;
+    return spec;
 }
 
-bool LabelSlider::isSliderDown() const
+void LabelSlider::invalidate(int flags)
 {
-    return m_slider->isSliderDown();
+    // Until the first show only the configuration is recorded; the layout,
+    // bars and labels are built in one go by showEvent(). Polishing is not
+    // enough, since it also reaches children of pages that are never shown.
+    m_dirty |= flags;
+    if (m_updateDepth == 0 && m_grid)
+    {
+        scheduleFlush();
+    }
 }
 
-void LabelSlider::setSliderPosition(int position)
+void LabelSlider::invalidateFormat()
 {
-    m_slider->setSliderPosition(position);
+    // Texts still being formatted with the old settings must not land in
+    // the fresh memo.
+    if (m_asyncState)
+        ++m_asyncState->generation;
+    m_formatMemo.clear();
+    invalidate(DirtyText);
 }
 
-int LabelSlider::sliderPosition() const
+void LabelSlider::invalidateText(qint64 value)
 {
-    return m_slider->sliderPosition();
+    if (!(m_dirty & (DirtyStructure | DirtyText)))
+    {
+        // Past a handful of values a full relabel is cheaper than the lookups.
+        if (m_dirtyValues.size() < 64)
+            m_dirtyValues.append(value);
+        else
+            m_dirty |= DirtyText;
+    }
+    invalidate(DirtyValueText);
 }
 
-void LabelSlider::setInvertedAppearance(bool inverted)
+void LabelSlider::scheduleFlush()
 {
-    m_slider->setInvertedAppearance(inverted);
-    rebuildLabels();
+    if (!m_flushQueued)
+    {
+        m_flushQueued = true;
+        QTimer::singleShot(0, this, &LabelSlider::flushPendingUpdates);
+    }
 }
 
-bool LabelSlider::invertedAppearance() const
+void LabelSlider::flushPendingUpdates()
 {
-    return m_slider->invertedAppearance();
+    m_flushQueued = false;
+    if (m_updateDepth > 0 || !m_dirty || (!m_grid && !isVisible()))
+        return;
+
+    if (m_dirty & DirtyStructure)
+    {
+        rebuildLabels();
+    }
+    else if (m_dirty & DirtyText)
+    {
+        refreshLabelText();
+    }
+    else if (m_dirty & DirtyValueText)
+    {
+        for (qint64 value : m_dirtyValues)
+        {
+            refreshLabelText(value);
+        }
+    }
+
+    if (m_dirty & DirtyGeometry)
+    {
+        // Bars of a freshly built layout have no geometry until it is activated.
+        if (this->layout())
+        {
+            LABELSLIDER_TRACE_SPAN(trace, "layoutActivate", this);
+            this->layout()->activate();
+        }
+        updateLabelPositions();
+    }
+
+    m_dirty = 0;
+    m_dirtyValues.clear();
+
+    if (m_asyncQueued)
+        startAsyncFormatting();
+    if (m_bubble)
+        updateValueBubble();
 }
 
-void LabelSlider::setInvertedControls(bool inverted)
+int LabelSlider::grooveLength() const
 {
-    m_slider->setInvertedControls(inverted);
+    return qMax(1, grooveGeometry().space);
 }
 
-bool LabelSlider::invertedControls() const
+double LabelSlider::labelUnits(int length) const
 {
-    return m_slider->invertedControls();
+    // Measure a few representative labels rather than all of them, so the cost
+    // does not depend on the range.
+    const qint64 min = viewportMinimum();
+    const qint64 max = viewportMaximum();
+    const qint64 mid = min + (max - min) / 2 / m_tickInterval * m_tickInterval;
+    const QFontMetrics fm = fontMetrics();
+    const bool horizontal = m_slider->orientation() == Qt::Horizontal;
+
+    int extent = 0;
+    for (qint64 v : {min, mid, max})
+    {
+        const QSize size = fm.size(0, measuredText(v));
+        extent = qMax(extent, horizontal ? size.width() : size.height());
+    }
+    extent += fm.height() / 2;
+
+    return double(extent) * double(max - min) / length;
 }
 
-void LabelSlider::setValue(int v)
+void LabelSlider::autoTickIntervals(qint64 *tickInterval, qint64 *labelInterval) const
 {
-    m_slider->setValue(v);
+    // Tick marks at least a few pixels apart, labels at a multiple of them wide
+    // enough that neighbouring labels never overlap.
+    const qint64 span = viewportMaximum() - viewportMinimum();
+    const int length = grooveLength();
+    *tickInterval = niceTickInterval(m_tickInterval, 4.0 * double(span) / length, span, 1);
+    *labelInterval = niceTickInterval(m_tickInterval, labelUnits(length), span, *tickInterval);
 }
 
-int LabelSlider::value() const
+qint64 LabelSlider::niceTickInterval(qint64 base, double minUnits, qint64 span, qint64 divisor)
 {
-    return m_slider->value();
+    // Smallest base * {1, 2, 5} * 10^n that covers minUnits and is a multiple of
+    // divisor; failing that, a single interval spanning the whole range, still
+    // kept on the grid of both base and divisor.
+    const auto wholeSpan = [base, span, divisor]() -> qint64 {
+        qint64 a = base;
+        qint64 b = divisor;
+        while (b != 0)
+        {
+            const qint64 r = a % b;
+            a = b;
+            b = r;
+        }
+        const qint64 step = base / a;
+        if (step > std::numeric_limits<qint64>::max() / divisor)
+            return qMax(base, divisor);
+        const qint64 unit = step * divisor;
+        const qint64 count = span / unit + (span % unit != 0 ? 1 : 0);
+        if (count > std::numeric_limits<qint64>::max() / unit)
+            return unit * (span / unit);
+        return unit * qMax<qint64>(count, 1);
+    };
+    for (qint64 decade = 1;; decade *= 10)
+    {
+        for (int factor : {1, 2, 5})
+        {
+            // Past span / (factor * decade) the product can only overshoot.
+            if (base > span / (factor * decade))
+                return wholeSpan();
+            const qint64 interval = base * factor * decade;
+            if (interval >= span)
+                return interval % divisor == 0 ? interval : wholeSpan();
+            if (interval % divisor == 0 && interval >= minUnits)
+                return interval;
+        }
+        if (decade > span / 10)
+            return wholeSpan();
+    }
 }
 
-void LabelSlider::setTickValuesVisible(bool visible)
+void LabelSlider::rebuildLabels()
 {
-    if (m_showTickValues != visible)
+    LABELSLIDER_TRACE_SPAN(trace, "rebuildLabels", this);
+    if (!m_grid)
     {
-        m_showTickValues = visible;
-        rebuildLabels();
+        m_grid = new QGridLayout(this);
     }
-}
 
-bool LabelSlider::tickValuesVisible() const
-{
-    return m_showTickValues;
-}
+    const qint64 lo = viewportMinimum();
+    const qint64 hi = viewportMaximum();
+    const qint64 span = hi - lo;
+    const QSlider::TickPosition tickPos = m_slider->tickPosition();
+    const bool showLabels = tickPos != QSlider::NoTicks && m_tickInterval > 0 && span > 0 && m_showTickValues;
+
+    // A viewport always picks its intervals from the visible span, which gives
+    // coarser levels of detail as it zooms out.
+    m_labelInterval = m_tickInterval;
+    m_drawnTickInterval = m_tickInterval;
+    if ((m_autoTickInterval || m_viewportActive) && m_tickInterval > 0 && span > 0)
+    {
+        autoTickIntervals(&m_drawnTickInterval, &m_labelInterval);
+    }
+    m_slider->setTickInterval(sliderTickInterval(m_drawnTickInterval));
+    const qint64 tickOrigin = (m_minimum - m_sliderBase) / m_sliderStride;
+    const bool alignTicks = m_viewportActive && m_scaleTable.isEmpty();
+    if (m_slider->alignTicks != alignTicks || m_slider->tickOrigin != tickOrigin)
+    {
+        m_slider->alignTicks = alignTicks;
+        m_slider->tickOrigin = tickOrigin;
+        m_slider->update();
+    }
+
+    const bool leading = showLabels && (tickPos == QSlider::TicksAbove || tickPos == QSlider::TicksBothSides);
+    const bool trailing = showLabels && (tickPos == QSlider::TicksBelow || tickPos == QSlider::TicksBothSides);
+
+    arrangeLayout(leading, trailing);
+    if (!showLabels)
+    {
+        setCurveTicks(QVector<double>());
+        return;
+    }
+
+    // Ticks sit on the grid of the full range, starting at the first one inside
+    // the visible window.
+    const qint64 offset = (lo - m_minimum) % m_labelInterval;
+    qint64 first = offset > 0 ? lo + (m_labelInterval - offset) : lo;
+    int count = first > hi ? 0 : static_cast<int>(qMin<qint64>((hi - first) / m_labelInterval + 1, INT_MAX));
+    m_tickValues.clear();
+    if (!m_scaleTable.isEmpty())
+    {
+        // Non-linear scales keep the tick count, with ticks at values rounded
+        // to two significant digits near evenly spaced groove positions. The
+        // rounded values sit on the curve, so the slider draws its marks there
+        // instead of at the style's even intervals.
+        const int divisions = static_cast<int>(qBound<qint64>(1, span / m_labelInterval, scaleResolution));
+        const int steps = m_scaleTable.size() - 1;
+        for (int i = 0; i <= divisions; ++i)
+        {
+            qint64 value = m_scaleTable.at(static_cast<int>(qint64(i) * steps / divisions));
+            if (i > 0 && i < divisions)
+            {
+                const double real = roundToSignificant(realValue(value), 2);
+                const double units = m_floatingPoint ? (real - m_minimumF) / m_resolution : real;
+                value = qBound(lo, qint64(std::llround(units)), hi);
+            }
+            if (m_tickValues.isEmpty() || value > m_tickValues.last())
+                m_tickValues.append(value);
+        }
+        first = m_tickValues.first();
+        count = m_tickValues.size();
+
+        QVector<double> ratios;
+        ratios.reserve(count);
+        for (qint64 value : m_tickValues)
+        {
+            ratios.append(scalePosition(value) / steps);
+        }
+        setCurveTicks(ratios);
+    }
+    else
+    {
+        setCurveTicks(QVector<double>());
+    }
+    m_firstTick = first;
+    LABELSLIDER_TRACE_TICKS(trace, count);
+
+    const bool reformat = m_dirty & (DirtyText | DirtyValueText);
+    if (leading)
+        fillBar(m_leadingBar, count, reformat);
+    if (trailing)
+        fillBar(m_trailingBar, count, reformat);
 
-void LabelSlider::setRange(int min, int max)
-{
-    m_slider->setRange(min, max);
-    rebuildLabels();
+    m_dirty |= DirtyGeometry;
 }
 
-void LabelSlider::triggerAction(QSlider::SliderAction action)
+void LabelSlider::setCurveTicks(const QVector<double> &ratios)
 {
-    m_slider->triggerAction(action);
+    if (m_slider->tickRatios != ratios)
+    {
+        m_slider->tickRatios = ratios;
+        m_slider->update();
+    }
 }
 
-void LabelSlider::setFormatType(FormatType type)
+void LabelSlider::arrangeLayout(bool leading, bool trailing)
 {
-    if (m_formatType != type)
+    const bool horizontal = m_slider->orientation() == Qt::Horizontal;
+    const int arrangement = (horizontal ? 0x1 : 0x2) | (leading ? 0x4 : 0) | (trailing ? 0x8 : 0);
+    if (m_arrangement == arrangement)
+        return;
+    m_arrangement = arrangement;
+
+    m_grid->removeWidget(m_slider);
+    for (TickBar *bar : {m_leadingBar, m_trailingBar})
     {
-        m_formatType = type;
-        rebuildLabels();
+        if (bar)
+            m_grid->removeWidget(bar);
+    }
+    for (int i = 0; i < 3; ++i)
+    {
+        m_grid->setRowStretch(i, 0);
+        m_grid->setColumnStretch(i, 0);
     }
-}
 
-LabelSlider::FormatType LabelSlider::formatType() const
-{
-    return m_formatType;
+    // The slider always sits in the middle cell, bars before and after it.
+    auto place = [&](QWidget *widget, int cell) {
+        if (horizontal)
+            m_grid->addWidget(widget, cell, 0);
+        else
+            m_grid->addWidget(widget, 0, cell);
+    };
+
+    place(m_slider, 1);
+    if (horizontal)
+        m_grid->setRowStretch(1, 1);
+    else
+        m_grid->setColumnStretch(1, 1);
+
+    auto setupBar = [&](TickBar *&bar, bool used, bool alignEnd, int cell) {
+        if (!used)
+        {
+            if (bar)
+            {
+                bar->active = false;
+                bar->hide();
+            }
+            return;
+        }
+
+        if (!bar)
+            bar = new TickBar(this);
+        bar->active = true;
+        bar->alignEnd = alignEnd;
+        bar->setMinimumSize(0, 0);
+        if (horizontal)
+            bar->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Fixed);
+        else
+            bar->setSizePolicy(QSizePolicy::Fixed, QSizePolicy::Expanding);
+        place(bar, cell);
+        bar->show();
+    };
+
+    setupBar(m_leadingBar, leading, !horizontal, 0);
+    setupBar(m_trailingBar, trailing, false, 2);
 }
 
-void LabelSlider::setFormatSuffix(const QString &suffix)
+void LabelSlider::fillBar(TickBar *bar, int count, bool reformat)
 {
-    if (m_formatSuffix != suffix)
+    const qint64 first = m_firstTick;
+    const qint64 interval = m_labelInterval;
+    const bool painted = m_renderMode == PaintedLabels;
+
+    if (painted)
     {
-        m_formatSuffix = suffix;
-        if (m_formatType == SimpleFormat)
+        qDeleteAll(bar->labels);
+        bar->labels.clear();
+    }
+    else if (bar->labels.size() != bar->items.size())
+    {
+        // Switching from PaintedLabels: existing items have no widgets yet.
+        bar->items.clear();
+    }
+
+    if (!bar->items.isEmpty() && m_tickValues.isEmpty())
+    {
+        const int shift = rotationToFirst(bar->items.at(0).value, first, interval, bar->items.size());
+        if (shift)
         {
-            rebuildLabels();
+            std::rotate(bar->items.begin(), bar->items.begin() + shift, bar->items.end());
+            if (!painted)
+                std::rotate(bar->labels.begin(), bar->labels.begin() + shift, bar->labels.end());
         }
     }
-}
+    const int kept = qMin(count, bar->items.size());
+    bar->items.resize(count);
 
-QString LabelSlider::formatSuffix() const
-{
-    return m_formatSuffix;
-}
+    if (!painted)
+    {
+        // Only the difference in tick count is allocated or freed; the rest of
+        // the pool is relabelled in place.
+        while (bar->labels.size() > count)
+        {
+            delete bar->labels.takeLast();
+        }
+        while (bar->labels.size() < count)
+        {
+            QLabel *lbl = new QLabel(bar);
+            lbl->setAlignment(Qt::AlignHCenter | Qt::AlignVCenter);
+            lbl->show();
+            bar->labels.append(lbl);
+        }
+    }
 
-void LabelSlider::setFormatPrefixSuffix(const QString &prefix, const QString &suffix)
-{
-    bool changed = (m_formatPrefix != prefix || m_formatSuffix != suffix);
-    m_formatPrefix = prefix;
-    m_formatSuffix = suffix;
-    if (changed && m_formatType == PrefixSuffixFormat)
+    LabelTextCache &cache = LabelTextCache::instance();
+    LabelTextCache::Font *font = cache.font(bar->font());
+    for (int i = 0; i < count; ++i)
     {
-        rebuildLabels();
+        TickBar::Item &item = bar->items[i];
+        const qint64 val = m_tickValues.isEmpty() ? first + i * interval : m_tickValues.at(i);
+        if (!reformat && i < kept && item.value == val)
+            continue;
+
+        item.value = val;
+        const LabelTextCache::Entry entry = cache.lookup(font, labelText(bar, i), painted);
+        item.text = entry.text;
+        if (painted)
+        {
+            item.staticText = entry.staticText;
+            item.size = entry.size;
+        }
+        else
+        {
+            QLabel *lbl = bar->labels.at(i);
+            lbl->setText(item.text);
+            lbl->adjustSize();
+            item.size = lbl->size();
+        }
     }
-}
 
-QString LabelSlider::formatPrefix() const
-{
-    return m_formatPrefix;
+    updateBarExtent(bar);
 }
 
-void LabelSlider::setPrintfFormat(const QString &format)
+void LabelSlider::updateBarExtent(TickBar *bar)
 {
-    if (m_printfFormat != format)
+    const bool horizontal = m_slider->orientation() == Qt::Horizontal;
+    int extent = 0;
+    for (const TickBar::Item &item : bar->items)
     {
-        m_printfFormat = format;
-        if (m_formatType == PrintfFormat)
-        {
-            rebuildLabels();
-        }
+        extent = qMax(extent, horizontal ? item.size.height() : item.size.width());
     }
+
+    if (horizontal)
+        bar->setMinimumHeight(extent);
+    else
+        bar->setMinimumWidth(extent);
 }
 
-QString LabelSlider::printfFormat() const
+bool LabelSlider::relabel(TickBar *bar, int index)
 {
-    return m_printfFormat;
+    return setItemText(bar, index, labelText(bar, index));
 }
 
-void LabelSlider::setDecimalPlaces(int places)
+bool LabelSlider::setItemText(TickBar *bar, int index, const QString &text)
 {
-    if (m_decimalPlaces != places)
+    TickBar::Item &item = bar->items[index];
+    if (item.text == text)
+        return false;
+
+    LabelTextCache &cache = LabelTextCache::instance();
+    const LabelTextCache::Entry entry =
+        cache.lookup(cache.font(bar->font()), text, m_renderMode == PaintedLabels);
+    item.text = entry.text;
+
+    QSize size;
+    if (m_renderMode == PaintedLabels)
     {
-        m_decimalPlaces = qMax(0, places);
-        rebuildLabels();
+        item.staticText = entry.staticText;
+        size = entry.size;
+        if (size == item.size)
+            bar->update(QRect(item.pos, item.size));
+    }
+    else
+    {
+        QLabel *lbl = bar->labels.at(index);
+        lbl->setText(item.text);
+        lbl->adjustSize();
+        size = lbl->size();
     }
+
+    if (size == item.size)
+        return false;
+    item.size = size;
+    return true;
 }
 
-int LabelSlider::decimalPlaces() const
+QString LabelSlider::labelText(TickBar *bar, int index)
 {
-    return m_decimalPlaces;
+    TickBar::Item &item = bar->items[index];
+    item.pending = formatsAsync() && !m_formatMemo.contains(item.value);
+    if (!item.pending)
+        return formatValue(item.value);
+
+    m_asyncQueued = true;
+    return QString(QChar(0x2026));
 }
 
-void LabelSlider::setValueScale(double scale)
+void LabelSlider::startAsyncFormatting()
 {
-    if (qAbs(m_valueScale - scale) > 1e-6)
+    m_asyncQueued = false;
+    ensureAsyncState();
+    const int generation = ++m_asyncState->generation;
+
+    // Everything still showing a placeholder, including labels left over from
+    // a request this one supersedes.
+    QVector<qint64> values;
+    for (TickBar *bar : {m_leadingBar, m_trailingBar})
     {
-        m_valueScale = scale;
-        rebuildLabels();
+        if (!bar || !bar->active)
+            continue;
+        for (const TickBar::Item &item : bar->items)
+        {
+            if (item.pending)
+                values.append(item.value);
+        }
     }
-}
+    std::sort(values.begin(), values.end());
+    values.erase(std::unique(values.begin(), values.end()), values.end());
 
-double LabelSlider::valueScale() const
-{
-    return m_valueScale;
+    const int batch = 32;
+    for (int start = 0; start < values.size(); start += batch)
+    {
+        startFormatJob(generation, values.mid(start, batch), false);
+    }
 }
 
-void LabelSlider::setCustomFormatter(std::function<QString(int)> formatter)
+void LabelSlider::ensureAsyncState()
 {
-    m_customFormatter = formatter;
-    if (m_formatType == CustomFunction)
+    if (!m_asyncState)
     {
-        rebuildLabels();
+        m_asyncState = std::make_shared<AsyncFormatState>();
+        m_asyncState->owner = this;
     }
 }
 
-void LabelSlider::setCustomLabels(const QMap<int, QString> &labels)
+void LabelSlider::startFormatJob(int generation, const QVector<qint64> &values, bool bubble)
 {
-    m_customLabels = labels;
-    if (m_formatType == CustomMapping)
+    FormatJob *job = new FormatJob;
+    job->state = m_asyncState;
+    job->generation = generation;
+    job->bubble = bubble;
+    job->formatter = m_customFormatter;
+    job->formatterF = m_customFormatterF;
+    job->values = values;
+    job->reals.reserve(values.size());
+    for (qint64 value : values)
     {
-        rebuildLabels();
+        job->reals.append(realValue(value));
     }
+    QThreadPool::globalInstance()->start(job);
 }
 
-QMap<int, QString> LabelSlider::customLabels() const
+void LabelSlider::requestBubbleText(qint64 value)
 {
-    return m_customLabels;
+    // One request at a time: a fast drag would otherwise queue a job per
+    // position. The reply shows the bubble again, which asks for whatever
+    // value the handle is at by then.
+    if (m_bubbleFormatting)
+        return;
+    ensureAsyncState();
+    m_bubbleFormatting = true;
+    startFormatJob(m_asyncState->generation.load(), {value}, true);
 }
 
-void LabelSlider::setCustomLabel(int value, const QString &label)
+bool LabelSlider::formatsAsync() const
 {
-    m_customLabels[value] = label;
-    if (m_formatType == CustomMapping)
-    {
-        rebuildLabels();
-    }
+    return m_asyncFormatting && m_formatType == CustomFunction && (m_customFormatter || m_customFormatterF);
 }
 
-void LabelSlider::clearCustomLabels()
+QString LabelSlider::measuredText(qint64 value) const
 {
-    m_customLabels.clear();
-    if (m_formatType == CustomMapping)
+    // Layout estimates must not wait for a slow formatter; until its text is
+    // known, a label is sized as the plain number.
+    if (formatsAsync() && !m_formatMemo.contains(value))
     {
-        rebuildLabels();
+        QString text;
+        appendNumber(text, value);
+        return text;
     }
+    return formatValue(value);
 }
 
-QString LabelSlider::formatValue(int value) const
+void LabelSlider::applyAsyncLabels(const QVector<qint64> &values, const QVector<QString> &texts)
 {
-    switch (m_formatType)
+    for (int i = 0; i < values.size(); ++i)
     {
-    case SimpleFormat:
-        if (m_decimalPlaces > 0)
-        {
-            double scaledValue = value * m_valueScale;
-            return QString::number(scaledValue, 'f', m_decimalPlaces) + m_formatSuffix;
-        }
-        else
-        {
-            int scaledValue = static_cast<int>(value * m_valueScale);
-            return QString::number(scaledValue) + m_formatSuffix;
-        }
+        m_formatMemo.insert(values.at(i), texts.at(i));
+    }
 
-    case PrefixSuffixFormat:
-        if (m_decimalPlaces > 0)
-        {
-            double scaledValue = value * m_valueScale;
-            return m_formatPrefix + QString::number(scaledValue, 'f', m_decimalPlaces) + m_formatSuffix;
-        }
-        else
-        {
-            int scaledValue = static_cast<int>(value * m_valueScale);
-            return m_formatPrefix + QString::number(scaledValue) + m_formatSuffix;
-        }
+    for (TickBar *bar : {m_leadingBar, m_trailingBar})
+    {
+        if (!bar || !bar->active)
+            continue;
 
-    case PrintfFormat: {
-        double scaledValue = value * m_valueScale;
-        if (m_printfFormat.contains('f') || m_printfFormat.contains('e') || m_printfFormat.contains('g'))
-        {
-            return QString::asprintf(m_printfFormat.toLocal8Bit().data(), scaledValue);
-        }
-        else
+        bool resized = false;
+        for (int i = 0; i < values.size(); ++i)
         {
-            return QString::asprintf(m_printfFormat.toLocal8Bit().data(), static_cast<int>(scaledValue));
-        }
-    }
+            const int index = tickIndex(values.at(i));
+            if (index < 0 || index >= bar->labelCount() || !bar->items.at(index).pending)
+                continue;
 
-    case CustomFunction:
-        if (m_customFormatter)
-        {
-            return m_customFormatter(value);
+            bar->items[index].pending = false;
+            resized |= setItemText(bar, index, texts.at(i));
         }
-        return QString::number(value);
 
-    case CustomMapping:
-        if (m_customLabels.contains(value))
+        if (resized)
         {
-            return m_customLabels[value];
+            updateBarExtent(bar);
+            invalidate(DirtyGeometry);
         }
-        return QString::number(static_cast<int>(value * m_valueScale));
     }
-
-    return QString::number(value);
 }
 
-void LabelSlider::rebuildLabels()
+void LabelSlider::setAsyncFormatting(bool enable)
 {
-    if (this->layout())
-    {
-        delete this->layout();
-    }
-    qDeleteAll(m_labels);
-    m_labels.clear();
-
-    int span = m_slider->maximum() - m_slider->minimum();
-    QGridLayout *grid = new QGridLayout(this);
-
-    if (m_slider->tickPosition() == QSlider::NoTicks || m_slider->tickInterval() <= 0 || span <= 0 || !m_showTickValues)
-    {
-        grid->addWidget(m_slider, 0, 0);
+    if (m_asyncFormatting == enable)
         return;
-    }
-
-    const int interval = m_slider->tickInterval();
-    const int steps = span / interval;
-    const int count = steps + 1;
-    const int min = m_slider->minimum();
-    QSlider::TickPosition tickPos = m_slider->tickPosition();
+    m_asyncFormatting = enable;
+    if (m_asyncState)
+        ++m_asyncState->generation;
+    if (m_formatType == CustomFunction)
+        invalidate(DirtyText);
+}
 
-    auto makeLabel = [&](QWidget *bar, int val) {
-        QLabel *lbl = new QLabel(formatValue(val), bar);
-        lbl->setAlignment(Qt::AlignHCenter | Qt::AlignVCenter);
-        lbl->setProperty("ls_value", val);
-        lbl->adjustSize();
-        m_labels.append(lbl);
-        return lbl;
-    };
+bool LabelSlider::asyncFormatting() const
+{
+    return m_asyncFormatting;
+}
 
-    if (m_slider->orientation() == Qt::Horizontal)
+void LabelSlider::refreshLabelText()
+{
+    LABELSLIDER_TRACE_SPAN(trace, "refreshLabelText", this);
+    for (TickBar *bar : {m_leadingBar, m_trailingBar})
     {
-        int row = 0;
-        if (tickPos == QSlider::TicksAbove || tickPos == QSlider::TicksBothSides)
-        {
-            QWidget *topBar = new QWidget(this);
-            topBar->setProperty("ls_side", "top");
-            topBar->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Fixed);
-            topBar->setAttribute(Qt::WA_TransparentForMouseEvents, true);
-            int maxH = 0;
-            for (int i = 0; i < count; ++i)
-            {
-                auto *lbl = makeLabel(topBar, min + i * interval);
-                maxH = qMax(maxH, lbl->height());
-            }
+        if (!bar || !bar->active)
+            continue;
 
-            topBar->setMinimumHeight(maxH);
-            grid->addWidget(topBar, row, 0);
-            grid->setRowStretch(row, 0);
-            ++row;
+        bool resized = false;
+        const int count = bar->labelCount();
+        for (int i = 0; i < count; ++i)
+        {
+            resized |= relabel(bar, i);
         }
 
-        grid->addWidget(m_slider, row, 0);
-        grid->setRowStretch(row, 1);
-        ++row;
-
-        if (tickPos == QSlider::TicksBelow || tickPos == QSlider::TicksBothSides)
+        if (resized)
         {
-            QWidget *bottomBar = new QWidget(this);
-            bottomBar->setProperty("ls_side", "bottom");
-            bottomBar->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Fixed);
-            bottomBar->setAttribute(Qt::WA_TransparentForMouseEvents, true);
-            int maxH = 0;
-            for (int i = 0; i < count; ++i)
-            {
-                auto *lbl = makeLabel(bottomBar, min + (count - 1 - i) * interval);
-                maxH = qMax(maxH, lbl->height());
-            }
-
-            bottomBar->setMinimumHeight(maxH);
-            grid->addWidget(bottomBar, row, 0);
-            grid->setRowStretch(row, 0);
+            updateBarExtent(bar);
+            m_dirty |= DirtyGeometry;
         }
     }
-    else
+}
+
+int LabelSlider::tickIndex(qint64 value) const
+{
+    if (!m_tickValues.isEmpty())
     {
-        int column = 0;
-        if (tickPos == QSlider::TicksLeft || tickPos == QSlider::TicksBothSides)
-        {
-            QWidget *leftBar = new QWidget(this);
-            leftBar->setProperty("ls_side", "left");
-            leftBar->setSizePolicy(QSizePolicy::Fixed, QSizePolicy::Expanding);
-            leftBar->setAttribute(Qt::WA_TransparentForMouseEvents, true);
-            int maxW = 0;
-            for (int i = 0; i < count; ++i)
-            {
-                auto *lbl = makeLabel(leftBar, min + i * interval);
-                maxW = qMax(maxW, lbl->width());
-            }
+        const auto it = std::lower_bound(m_tickValues.constBegin(), m_tickValues.constEnd(), value);
+        return it != m_tickValues.constEnd() && *it == value ? static_cast<int>(it - m_tickValues.constBegin()) : -1;
+    }
 
-            leftBar->setMinimumWidth(maxW);
-            grid->addWidget(leftBar, 0, column);
-            grid->setColumnStretch(column, 0);
-            ++column;
-        }
+    const qint64 first = m_firstTick;
+    const qint64 interval = m_labelInterval;
+    if (interval <= 0 || value < first || (value - first) % interval != 0 || (value - first) / interval >= INT_MAX)
+        return -1;
+    return static_cast<int>((value - first) / interval);
+}
+
+void LabelSlider::refreshLabelText(qint64 value)
+{
+    const int index = tickIndex(value);
+    if (index < 0)
+        return;
 
-        grid->addWidget(m_slider, 0, column);
-        grid->setColumnStretch(column, 1);
-        ++column;
+    for (TickBar *bar : {m_leadingBar, m_trailingBar})
+    {
+        if (!bar || !bar->active || index >= bar->labelCount())
+            continue;
 
-        if (tickPos == QSlider::TicksRight || tickPos == QSlider::TicksBothSides)
+        if (relabel(bar, index))
         {
-            QWidget *rightBar = new QWidget(this);
-            rightBar->setProperty("ls_side", "right");
-            rightBar->setSizePolicy(QSizePolicy::Fixed, QSizePolicy::Expanding);
-            rightBar->setAttribute(Qt::WA_TransparentForMouseEvents, true);
-            int maxW = 0;
-            for (int i = 0; i < count; ++i)
-            {
-                auto *lbl = makeLabel(rightBar, min + (count - 1 - i) * interval);
-                maxW = qMax(maxW, lbl->width());
-            }
-            rightBar->setMinimumWidth(maxW);
-            grid->addWidget(rightBar, 0, column);
-            grid->setColumnStretch(column, 0);
+            updateBarExtent(bar);
+            m_dirty |= DirtyGeometry;
         }
     }
-
-    QTimer::singleShot(0, this, &LabelSlider::updateLabelPositions);
 }
 
-void LabelSlider::updateLabelPositions()
+const LabelSlider::GrooveGeometry &LabelSlider::grooveGeometry() const
 {
-    if (m_labels.isEmpty())
-        return;
+    // The style is only asked again when something it depends on has changed.
+    const int key = m_slider->orientation() | (m_slider->invertedAppearance() ? 0x10 : 0) |
+                    (m_slider->tickPosition() << 8);
+    if (m_groove.valid && m_groove.size == m_slider->size() && m_groove.style == m_slider->style() &&
+        m_groove.key == key)
+    {
+        return m_groove;
+    }
 
     QStyleOptionSlider opt;
     opt.initFrom(m_slider);
@@ -535,46 +3658,189 @@ void LabelSlider::updateLabelPositions()
     opt.upsideDown =
         (opt.orientation == Qt::Horizontal) ? m_slider->invertedAppearance() : !m_slider->invertedAppearance();
 
-    const QRect sliderGroove =
-        m_slider->style()->subControlRect(QStyle::CC_Slider, &opt, QStyle::SC_SliderGroove, m_slider);
-    const int sliderLength = m_slider->style()->pixelMetric(QStyle::PM_SliderLength, &opt, m_slider);
-    const int space = (opt.orientation == Qt::Horizontal) ? (sliderGroove.width() - sliderLength)
-                                                          : (sliderGroove.height() - sliderLength);
+    QStyle *style = m_slider->style();
+    const QRect sliderGroove = style->subControlRect(QStyle::CC_Slider, &opt, QStyle::SC_SliderGroove, m_slider);
+    const int sliderLength = style->pixelMetric(QStyle::PM_SliderLength, &opt, m_slider);
 
-    for (auto it = m_labels.cbegin(); it != m_labels.cend(); ++it)
+    m_groove.size = m_slider->size();
+    m_groove.style = style;
+    m_groove.key = key;
+    m_groove.upsideDown = opt.upsideDown;
+    if (opt.orientation == Qt::Horizontal)
     {
-        QLabel *lbl = *it;
-        if (!lbl)
-            continue;
+        m_groove.origin = sliderGroove.x() + sliderLength / 2;
+        m_groove.space = sliderGroove.width() - sliderLength;
+    }
+    else
+    {
+        m_groove.origin = sliderGroove.y() + sliderLength / 2;
+        m_groove.space = sliderGroove.height() - sliderLength;
+    }
+    m_groove.valid = true;
+    return m_groove;
+}
 
-        const int val = lbl->property("ls_value").toInt();
-        const int pos = QStyle::sliderPositionFromValue(opt.minimum, opt.maximum, val, space, opt.upsideDown);
-        QWidget *bar = qobject_cast<QWidget *>(lbl->parent());
-        if (!bar)
+void LabelSlider::updateLabelPositions()
+{
+    const bool leading = m_leadingBar && m_leadingBar->active;
+    const bool trailing = m_trailingBar && m_trailingBar->active;
+    if (!leading && !trailing)
+        return;
+
+    LABELSLIDER_TRACE_SPAN(trace, "updateLabelPositions", this);
+    LABELSLIDER_TRACE_TICKS(trace, (leading ? m_leadingBar->labelCount() : 0) +
+                                      (trailing ? m_trailingBar->labelCount() : 0));
+
+    const GrooveGeometry &groove = grooveGeometry();
+    const bool horizontal = m_slider->orientation() == Qt::Horizontal;
+
+    for (TickBar *bar : {m_leadingBar, m_trailingBar})
+    {
+        if (!bar || !bar->active)
             continue;
 
-        if (m_slider->orientation() == Qt::Horizontal)
+        // Groove start in bar coordinates; everything below is integer math.
+        const QPoint offset = m_slider->pos() - bar->pos();
+        const int base = groove.origin + (horizontal ? offset.x() : offset.y());
+        const int barWidth = bar->width();
+        const int barHeight = bar->height();
+        const bool widgets = !bar->labels.isEmpty();
+
+        for (int i = 0, n = bar->items.size(); i < n; ++i)
         {
-            const int baseX = m_slider->x() + sliderGroove.x() - bar->x() + sliderLength / 2;
-            int x = baseX + pos - lbl->width() / 2;
-            x = qBound(0, x, bar->width() - lbl->width());
-            const int y = (bar->height() - lbl->height()) / 2;
-            lbl->move(x, y);
+            TickBar::Item &item = bar->items[i];
+            const int pos = base + pixelOffset(item.value, groove.space, groove.upsideDown);
+            QPoint at;
+            if (horizontal)
+            {
+                at.setX(qBound(0, pos - item.size.width() / 2, barWidth - item.size.width()));
+                at.setY((barHeight - item.size.height()) / 2);
+            }
+            else
+            {
+                at.setX(bar->alignEnd ? barWidth - item.size.width() : 0);
+                at.setY(qBound(0, pos - item.size.height() / 2, barHeight - item.size.height()));
+            }
+            item.pos = at;
+
+            if (widgets)
+            {
+                QLabel *lbl = bar->labels.at(i);
+                if (lbl->pos() != at)
+                    lbl->move(at);
+            }
         }
-        else
+
+        if (!widgets)
+            bar->update();
+    }
+}
+
+QSize LabelSlider::sizeHint() const
+{
+    return m_grid ? QWidget::sizeHint() : estimatedSize(m_slider->sizeHint());
+}
+
+QSize LabelSlider::minimumSizeHint() const
+{
+    return m_grid ? QWidget::minimumSizeHint() : estimatedSize(m_slider->minimumSizeHint());
+}
+
+QSize LabelSlider::estimatedSize(QSize size) const
+{
+    // Before the first show there is no layout to ask: the label bars are
+    // estimated from the font and the texts at both ends of the range, so
+    // that a hidden slider still lays out sensibly without child widgets.
+    const QStyle *style = this->style();
+    const bool horizontal = m_slider->orientation() == Qt::Horizontal;
+    size += QSize(style->pixelMetric(QStyle::PM_LayoutLeftMargin, nullptr, this) +
+                      style->pixelMetric(QStyle::PM_LayoutRightMargin, nullptr, this),
+                  style->pixelMetric(QStyle::PM_LayoutTopMargin, nullptr, this) +
+                      style->pixelMetric(QStyle::PM_LayoutBottomMargin, nullptr, this));
+
+    const QSlider::TickPosition tickPos = m_slider->tickPosition();
+    if (tickPos == QSlider::NoTicks || m_tickInterval <= 0 || !m_showTickValues)
+        return size;
+
+    const QFontMetrics metrics = fontMetrics();
+    const int bars = tickPos == QSlider::TicksBothSides ? 2 : 1;
+    const int spacing = qMax(0, style->pixelMetric(horizontal ? QStyle::PM_LayoutVerticalSpacing
+                                                              : QStyle::PM_LayoutHorizontalSpacing,
+                                                   nullptr, this));
+    int extent = metrics.height();
+    if (!horizontal)
+    {
+        extent = qMax(metrics.size(Qt::TextSingleLine, measuredText(viewportMinimum())).width(),
+                      metrics.size(Qt::TextSingleLine, measuredText(viewportMaximum())).width());
+    }
+    if (horizontal)
+        size.rheight() += bars * (extent + spacing);
+    else
+        size.rwidth() += bars * (extent + spacing);
+    return size;
+}
+
+bool LabelSlider::event(QEvent *event)
+{
+    if (event->type() == AsyncLabelsEvent::eventType())
+    {
+        const AsyncLabelsEvent *result = static_cast<AsyncLabelsEvent *>(event);
+        if (result->generation == m_asyncState->generation.load() && result->texts.size() == result->values.size())
+            applyAsyncLabels(result->values, result->texts);
+        if (result->bubble)
         {
-            const QString side = bar->property("ls_side").toString();
-            const int baseY = m_slider->y() + sliderGroove.y() - bar->y() + sliderLength / 2;
-            int y = baseY + pos - lbl->height() / 2;
-            y = qBound(0, y, bar->height() - lbl->height());
-            const int x = (side == "left") ? (bar->width() - lbl->width()) : 0;
-            lbl->move(x, y);
+            m_bubbleFormatting = false;
+            if (m_bubble)
+                updateValueBubble();
         }
+        return true;
     }
+    return QWidget::event(event);
+}
+
+void LabelSlider::changeEvent(QEvent *event)
+{
+    if (event->type() == QEvent::StyleChange)
+    {
+        // A style sheet can change metrics without changing the style object.
+        m_groove.valid = false;
+        invalidate(DirtyGeometry);
+    }
+    else if (event->type() == QEvent::FontChange)
+    {
+        // Every label is measured again in the new font, and the automatic
+        // intervals follow the new widths.
+        m_groove.valid = false;
+        invalidate(DirtyStructure | DirtyText | DirtyGeometry);
+    }
+    QWidget::changeEvent(event);
+}
+
+void LabelSlider::showEvent(QShowEvent *event)
+{
+    // Bound values are not polled while hidden.
+    if (m_binding)
+        requestFrame();
+    flushPendingUpdates();
+    QWidget::showEvent(event);
 }
 
 void LabelSlider::resizeEvent(QResizeEvent *event)
 {
     QWidget::resizeEvent(event);
+    if (m_dirty & DirtyStructure)
+        return;
+
     updateLabelPositions();
-}
\ No newline at end of file
+    if (m_bubble)
+        updateValueBubble();
+
+    if ((m_autoTickInterval || m_viewportActive) && m_labelInterval > 0 && viewportMaximum() > viewportMinimum())
+    {
+        qint64 tickInterval = 0;
+        qint64 labelInterval = 0;
+        autoTickIntervals(&tickInterval, &labelInterval);
+        if (tickInterval != m_drawnTickInterval || labelInterval != m_labelInterval)
+            invalidate(DirtyStructure);
+    }
+}
@@ -1,13 +1,22 @@
 #ifndef LABELSLIDER_H
 #define LABELSLIDER_H
 
+#include <QByteArray>
+#include <QEasingCurve>
+#include <QElapsedTimer>
+#include <QHash>
 #include <QLabel>
 #include <QList>
 #include <QMap>
 #include <QSlider>
 #include <QString>
+#include <QVector>
 #include <QWidget>
+#include <atomic>
 #include <functional>
+#include <memory>
+
+class QGridLayout;
 
 class LabelSlider : public QWidget
 {
@@ -23,6 +32,103 @@ class LabelSlider : public QWidget
         CustomMapping
     };
 
+    enum LabelRenderMode
+    {
+        WidgetLabels,
+        PaintedLabels
+    };
+
+    enum EmissionPolicy
+    {
+        EmitImmediately,
+        EmitPerFrame,
+        EmitRateLimited,
+        EmitOnRelease
+    };
+
+    enum ScaleType
+    {
+        LinearScale,
+        LogarithmicScale,
+        CustomScale
+    };
+
+    enum ValueIndicator
+    {
+        NoValueIndicator,
+        ValueWhileDragging,
+        ValueAlways
+    };
+
+    enum LatencyMeasure
+    {
+        InputToSignal,
+        InputToPaint
+    };
+
+    // Process-wide cache of measured label texts; bytes is an estimate.
+    struct LabelCacheStats
+    {
+        qint64 entries = 0;
+        qint64 bytes = 0;
+        qint64 hits = 0;
+        qint64 misses = 0;
+        qint64 evictions = 0;
+
+        double hitRate() const
+        {
+            return hits + misses > 0 ? double(hits) / double(hits + misses) : 0.0;
+        }
+    };
+
+    // A CustomMapping label for every value in [first, last). An aggregate,
+    // so that {first, last, text} works in C++11 as well.
+    struct LabelRange
+    {
+        qint64 first;
+        qint64 last;
+        QString text;
+    };
+
+    // Latencies in microseconds; percentiles are bucket upper bounds.
+    struct LatencyStats
+    {
+        qint64 samples = 0;
+        qint64 p50 = 0;
+        qint64 p99 = 0;
+        qint64 max = 0;
+    };
+
+    // The slider value shared with other threads, in model units. load() is
+    // wait-free from any thread; store() from any thread is picked up on the
+    // next display frame, with stores in between coalesced into the last one.
+    // The first store after the binding has gone idle posts one wake-up event
+    // to the GUI thread; all others are lock-free.
+    class SharedValue
+    {
+      public:
+        qint64 load() const
+        {
+            return m_value.load(std::memory_order_acquire);
+        }
+
+        void store(qint64 value)
+        {
+            m_request.store(value, std::memory_order_relaxed);
+            m_requested.store(true, std::memory_order_seq_cst);
+            if (m_idle.load(std::memory_order_seq_cst) && m_idle.exchange(false))
+                wake();
+        }
+
+      private:
+        friend class LabelSlider;
+        void wake();
+        std::atomic<qint64> m_value{0};
+        std::atomic<qint64> m_request{0};
+        std::atomic<bool> m_requested{false};
+        std::atomic<bool> m_idle{false};
+    };
+
   public:
     explicit LabelSlider(QWidget *parent = nullptr);
     explicit LabelSlider(Qt::Orientation orientation = Qt::Horizontal, QWidget *parent = nullptr);
@@ -34,6 +140,14 @@ class LabelSlider : public QWidget
 
     void setTickInterval(int ti);
     int tickInterval() const;
+    void setTickInterval64(qint64 ti);
+    qint64 tickInterval64() const;
+    void setTickIntervalF(double ti);
+    double tickIntervalF() const;
+
+    void setAutoTickInterval(bool enable);
+    bool autoTickInterval() const;
+    qint64 labelInterval() const;
 
     void setOrientation(Qt::Orientation);
     Qt::Orientation orientation() const;
@@ -67,12 +181,85 @@ class LabelSlider : public QWidget
 
     void setValue(int);
     int value() const;
+    QString valueText() const;
+    QString valueText(qint64 value) const;
 
     void setTickValuesVisible(bool visible);
     bool tickValuesVisible() const;
 
     void setRange(int min, int max);
 
+    void setRange64(qint64 min, qint64 max);
+    qint64 minimum64() const;
+    qint64 maximum64() const;
+    void setValue64(qint64 value);
+    qint64 value64() const;
+
+    void setRangeF(double min, double max, double resolution = 0.0);
+    double minimumF() const;
+    double maximumF() const;
+    double resolution() const;
+    bool isFloatingPoint() const;
+    void setValueF(double value);
+    double valueF() const;
+
+    void setScaleType(ScaleType type);
+    ScaleType scaleType() const;
+    void setCustomScale(std::function<double(double)> curve);
+
+    void setViewport(qint64 first, qint64 last);
+    void resetViewport();
+    qint64 viewportMinimum() const;
+    qint64 viewportMaximum() const;
+    bool hasViewport() const;
+    void zoomViewport(double factor, qint64 anchor);
+    void panViewport(qint64 delta);
+
+    void bindValue(std::shared_ptr<SharedValue> value);
+    std::shared_ptr<SharedValue> boundValue() const;
+
+    void setEmissionPolicy(EmissionPolicy policy);
+    EmissionPolicy emissionPolicy() const;
+    void setEmissionRate(int hz);
+    int emissionRate() const;
+
+    void setAnimationDuration(int msecs);
+    int animationDuration() const;
+    void setAnimationEasing(const QEasingCurve &easing);
+    QEasingCurve animationEasing() const;
+    void setAnimationEmissionPolicy(EmissionPolicy policy);
+    EmissionPolicy animationEmissionPolicy() const;
+    bool isAnimating() const;
+    void stopAnimation();
+
+    void beginUpdate();
+    void endUpdate();
+    bool isUpdating() const;
+
+    void setLabelRenderMode(LabelRenderMode mode);
+    LabelRenderMode labelRenderMode() const;
+
+    void setValueIndicator(ValueIndicator indicator);
+    ValueIndicator valueIndicator() const;
+
+    void setAsyncFormatting(bool enable);
+    bool asyncFormatting() const;
+
+    static LabelCacheStats labelCacheStats();
+    static void setLabelCacheCapacity(int entries);
+    static void clearLabelCache();
+
+    void setLatencyTracking(bool enable);
+    bool latencyTracking() const;
+    LatencyStats latencyStats(LatencyMeasure measure) const;
+    void resetLatencyStats();
+
+    static void setTracingEnabled(bool enable);
+    static bool isTracingEnabled();
+    static void clearTrace();
+    static QByteArray chromeTrace();
+    static bool saveChromeTrace(const QString &fileName);
+
     void triggerAction(QSlider::SliderAction action);
 
     void setFormatType(FormatType type);
@@ -94,40 +281,284 @@ class LabelSlider : public QWidget
     double valueScale() const;
 
     void setCustomFormatter(std::function<QString(int)> formatter);
+    void setCustomFormatterF(std::function<QString(double)> formatter);
     void setCustomLabels(const QMap<int, QString> &labels);
     QMap<int, QString> customLabels() const;
     void setCustomLabel(int value, const QString &label);
     void clearCustomLabels();
+    void setLabelRanges(const QVector<LabelRange> &ranges);
+    QVector<LabelRange> labelRanges() const;
+    void addLabelRange(qint64 first, qint64 last, const QString &label);
+
+    QByteArray saveState() const;
+    bool restoreState(const QByteArray &state);
+
+    QSize sizeHint() const override;
+    QSize minimumSizeHint() const override;
 
   signals:
     void valueChanged(int value);
+    void valueChanged64(qint64 value);
+    void valueChangedF(double value);
     void sliderMoved(int position);
+    void sliderMoved64(qint64 position);
+    void sliderMovedF(double position);
     void sliderPressed();
     void sliderReleased();
     void rangeChanged(int min, int max);
+    void rangeChanged64(qint64 min, qint64 max);
+    void rangeChangedF(double min, double max);
+    void viewportChanged(qint64 first, qint64 last);
     void actionTriggered(QAbstractSlider::SliderAction action);
 
   private slots:
     void updateLabelPositions();
-    
+    void flushPendingUpdates();
+    void updateValueBubble();
+
   private:
-    void rebuildLabels();
-    QString formatValue(int value) const;
+    class Slider;
+    class TickBar;
+    class LatencyProbe;
+    class FrameClock;
+    class FormatJob;
+    class ValueBubble;
+    struct AsyncFormatState;
+
+    // setPrintfFormat() string split into literal text and one validated
+    // conversion, so formatting never has to rescan or re-encode it.
+    struct PrintfSpec
+    {
+        QString prefix;
+        QString suffix;
+        QByteArray conversion;
+        char type = 0;
+        int precision = -1;
+        bool floating = false;
+        bool plain = false;
+        bool valid = false;
+    };
 
-    QSlider *m_slider;
-    QList<QLabel *> m_labels;
+    static PrintfSpec compilePrintfFormat(const QString &format);
+
+    struct MappedLabel
+    {
+        qint64 value;
+        QString text;
+    };
+
+    // What saveState() records: the model, ticks and formatting, but not the
+    // orientation, render mode, emission policy or any std::function.
+    struct State
+    {
+        bool floatingPoint = false;
+        qint64 minimum = 0;
+        qint64 maximum = 0;
+        qint64 value = 0;
+        double minimumF = 0.0;
+        double maximumF = 0.0;
+        double resolution = 1.0;
+        bool exactValid = false;
+        double exactValue = 0.0;
+        bool viewportActive = false;
+        qint64 viewMinimum = 0;
+        qint64 viewMaximum = 0;
+        qint32 scaleType = LinearScale;
+        qint32 singleStep = 1;
+        qint32 pageStep = 10;
+        qint32 tickPosition = QSlider::NoTicks;
+        qint64 tickInterval = 0;
+        bool autoTickInterval = false;
+        bool showTickValues = false;
+        qint32 formatType = SimpleFormat;
+        QString prefix;
+        QString suffix;
+        QString printfFormat;
+        qint32 decimalPlaces = 0;
+        double valueScale = 1.0;
+        QVector<MappedLabel> labelPoints;
+        QVector<LabelRange> labelRanges;
+    };
+
+    friend class LabelSliderGroup;
+    State state() const;
+    bool applyState(const State &state, bool silent = false);
+    static QByteArray encodeStates(const QVector<State> &states);
+    static bool decodeStates(const QByteArray &data, QVector<State> *states);
+
+    // Groove placement from the style, in slider coordinates, along with what
+    // it was computed for.
+    struct GrooveGeometry
+    {
+        QSize size;
+        const QStyle *style = nullptr;
+        int key = 0;
+        int origin = 0;
+        int space = 0;
+        bool upsideDown = false;
+        bool valid = false;
+    };
+
+    enum DirtyFlag
+    {
+        DirtyStructure = 0x1,
+        DirtyText = 0x2,
+        DirtyGeometry = 0x4,
+        DirtyValueText = 0x8
+    };
+
+    void invalidate(int flags);
+    void invalidateFormat();
+    void invalidateText(qint64 value);
+    void scheduleFlush();
+    const GrooveGeometry &grooveGeometry() const;
+    QSize estimatedSize(QSize size) const;
+    int grooveLength() const;
+    double labelUnits(int length) const;
+    void autoTickIntervals(qint64 *tickInterval, qint64 *labelInterval) const;
+    static qint64 niceTickInterval(qint64 base, double minUnits, qint64 span, qint64 divisor);
+    void applyRange(qint64 min, qint64 max, bool realChanged);
+    bool placeValue(qint64 value);
+    void emitValueChanged();
+    void inputValueChanged();
+    void flushPendingEmission();
+    void requestFrame();
+    void publishValue();
+    bool applyBoundValue();
+    void sleepBinding();
+    void animateTo(qint64 value);
+    void stepAnimation();
+    void frameTick();
+    double realValue(qint64 units) const;
+    qint64 valueFromSlider(int position) const;
+    int sliderFromValue(qint64 value) const;
+    int sliderTickInterval(qint64 interval) const;
+    int pixelOffset(qint64 value, int space, bool upsideDown) const;
+    void syncSlider();
+    void buildScaleTable(qint64 lo, qint64 hi);
+    double scalePosition(qint64 value) const;
+    int tickIndex(qint64 value) const;
+    void rebuildLabels();
+    void arrangeLayout(bool leading, bool trailing);
+    void setCurveTicks(const QVector<double> &ratios);
+    void fillBar(TickBar *bar, int count, bool reformat);
+    void updateBarExtent(TickBar *bar);
+    bool relabel(TickBar *bar, int index);
+    bool setItemText(TickBar *bar, int index, const QString &text);
+    QString labelText(TickBar *bar, int index);
+    void startAsyncFormatting();
+    void ensureAsyncState();
+    void startFormatJob(int generation, const QVector<qint64> &values, bool bubble);
+    void requestBubbleText(qint64 value);
+    bool formatsAsync() const;
+    QString measuredText(qint64 value) const;
+    void applyAsyncLabels(const QVector<qint64> &values, const QVector<QString> &texts);
+    void refreshLabelText();
+    void refreshLabelText(qint64 value);
+    QString formatValue(qint64 value) const;
+    QString formatText(qint64 value) const;
+    void appendNumber(QString &out, qint64 value) const;
+    void insertLabelRange(const LabelRange &range);
+    const QString *mappedLabel(qint64 value) const;
+
+    // The model works in qint64 units. In floating-point mode a unit is one
+    // resolution step above m_minimumF; the exact value last passed to
+    // setValueF() is kept so that it reads back unchanged.
+    Slider *m_slider;
+    LatencyProbe *m_latency = nullptr;
+    ValueBubble *m_bubble = nullptr;
+    ValueIndicator m_valueIndicator = NoValueIndicator;
+    qint64 m_minimum = 0;
+    qint64 m_maximum = 99;
+    qint64 m_value = 0;
+    int m_syncDepth = 0;
+
+    bool m_floatingPoint = false;
+    double m_minimumF = 0.0;
+    double m_maximumF = 99.0;
+    double m_resolution = 1.0;
+    bool m_exactValid = false;
+    qint64 m_exactUnits = 0;
+    double m_exactValue = 0.0;
+
+    // The inner QSlider only has int positions: position p stands for the
+    // value m_sliderBase + p * m_sliderStride.
+    qint64 m_sliderBase = 0;
+    qint64 m_sliderStride = 1;
+
+    // Non-linear scales map inner slider positions to values through a table
+    // built whenever the range or viewport changes; empty for LinearScale.
+    ScaleType m_scaleType = LinearScale;
+    std::function<double(double)> m_customScale;
+    QVector<qint64> m_scaleTable;
+    QVector<qint64> m_tickValues;
+
+    bool m_viewportActive = false;
+    qint64 m_viewMinimum = 0;
+    qint64 m_viewMaximum = 0;
+
+    QGridLayout *m_grid = nullptr;
+    TickBar *m_leadingBar = nullptr;
+    TickBar *m_trailingBar = nullptr;
+    int m_arrangement = 0;
     bool m_showTickValues = false;
+    qint64 m_tickInterval = 0;
+    qint64 m_drawnTickInterval = 0;
+    qint64 m_labelInterval = 0;
+    qint64 m_firstTick = 0;
+    bool m_autoTickInterval = false;
+    LabelRenderMode m_renderMode = WidgetLabels;
+    mutable GrooveGeometry m_groove;
+
+    EmissionPolicy m_emissionPolicy = EmitImmediately;
+    int m_emissionRate = 30;
+    bool m_emitPending = false;
+    qint64 m_emittedValue = 0;
+    QElapsedTimer m_lastEmission;
+    bool m_frameRequested = false;
+    std::shared_ptr<SharedValue> m_binding;
+    bool m_bindingAsleep = false;
+
+    // Programmatic value changes glide from m_animationFrom to m_animationTo
+    // over m_animationDuration, timed on the frame clock from
+    // m_animationStart.
+    int m_animationDuration = 0;
+    QEasingCurve m_animationEasing{QEasingCurve::OutCubic};
+    EmissionPolicy m_animationEmission = EmitPerFrame;
+    bool m_animating = false;
+    bool m_animationSilent = false;
+    qint64 m_animationFrom = 0;
+    qint64 m_animationTo = 0;
+    qint64 m_animationStart = 0;
+
+    int m_dirty = 0;
+    QVector<qint64> m_dirtyValues;
+    int m_updateDepth = 0;
+    bool m_flushQueued = false;
 
     FormatType m_formatType = SimpleFormat;
     QString m_formatPrefix;
     QString m_formatSuffix;
     QString m_printfFormat = "%d";
+    PrintfSpec m_printfSpec = compilePrintfFormat(m_printfFormat);
     int m_decimalPlaces = 0;
     double m_valueScale = 1.0;
     std::function<QString(int)> m_customFormatter;
-    QMap<int, QString> m_customLabels;
+    std::function<QString(double)> m_customFormatterF;
+    bool m_asyncFormatting = false;
+    bool m_asyncQueued = false;
+    bool m_bubbleFormatting = false;
+    std::shared_ptr<AsyncFormatState> m_asyncState;
+    // CustomMapping tables, sorted for binary search: single values, and
+    // disjoint ranges.
+    QVector<MappedLabel> m_labelPoints;
+    QVector<LabelRange> m_labelRanges;
+    mutable QHash<qint64, QString> m_formatMemo;
 
   protected:
+    bool event(QEvent *event) override;
+    void changeEvent(QEvent *event) override;
+    void showEvent(QShowEvent *event) override;
     void resizeEvent(QResizeEvent *event) override;
 };
 
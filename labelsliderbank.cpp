@@ -0,0 +1,645 @@
+#include "labelsliderbank.h"
+
+#include <QKeyEvent>
+#include <QMouseEvent>
+#include <QPaintEvent>
+#include <QPainter>
+#include <QStyle>
+#include <QStyleOptionSlider>
+#include <QWheelEvent>
+
+namespace
+{
+const int labelSpacing = 4;
+const int channelSpacing = 10;
+
+QPoint eventPos(const QMouseEvent *event)
+{
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+    return event->position().toPoint();
+#else
+    return event->pos();
+#endif
+}
+
+QPoint eventPos(const QWheelEvent *event)
+{
+#if QT_VERSION >= QT_VERSION_CHECK(5, 14, 0)
+    return event->position().toPoint();
+#else
+    return event->pos();
+#endif
+}
+} // namespace
+
+LabelSliderBank::LabelSliderBank(int channels, Qt::Orientation orientation, QWidget *parent)
+    : QWidget(parent), m_scale(new LabelSlider(orientation, nullptr)), m_orientation(orientation)
+{
+    m_scale->setRange(m_minimum, m_maximum);
+    m_channels.resize(qMax(0, channels));
+    setFocusPolicy(Qt::StrongFocus);
+}
+
+LabelSliderBank::~LabelSliderBank()
+{
+    delete m_scale;
+}
+
+void LabelSliderBank::setChannelCount(int channels)
+{
+    channels = qMax(0, channels);
+    if (channels == m_channels.size())
+        return;
+
+    m_channels.resize(channels);
+    for (Channel &channel : m_channels)
+    {
+        channel.value = qBound(m_minimum, channel.value, m_maximum);
+    }
+    if (m_pressedChannel >= channels)
+        m_pressedChannel = -1;
+    m_currentChannel = qBound(0, m_currentChannel, qMax(0, channels - 1));
+    updateGeometry();
+    update();
+}
+
+int LabelSliderBank::channelCount() const
+{
+    return m_channels.size();
+}
+
+void LabelSliderBank::setOrientation(Qt::Orientation orientation)
+{
+    if (m_orientation == orientation)
+        return;
+    m_orientation = orientation;
+    m_scale->setOrientation(orientation);
+    invalidateScale();
+    updateGeometry();
+}
+
+Qt::Orientation LabelSliderBank::orientation() const
+{
+    return m_orientation;
+}
+
+void LabelSliderBank::setRange(int min, int max)
+{
+    max = qMax(min, max);
+    if (m_minimum == min && m_maximum == max)
+        return;
+
+    m_minimum = min;
+    m_maximum = max;
+    m_scale->setRange(min, max);
+    invalidateScale();
+    emit rangeChanged(min, max);
+
+    for (int i = 0; i < m_channels.size(); ++i)
+    {
+        const int value = qBound(min, m_channels.at(i).value, max);
+        if (value != m_channels.at(i).value)
+        {
+            m_channels[i].value = value;
+            emit valueChanged(i, value);
+        }
+    }
+}
+
+int LabelSliderBank::minimum() const
+{
+    return m_minimum;
+}
+
+int LabelSliderBank::maximum() const
+{
+    return m_maximum;
+}
+
+void LabelSliderBank::setSingleStep(int step)
+{
+    m_singleStep = qMax(1, step);
+}
+
+int LabelSliderBank::singleStep() const
+{
+    return m_singleStep;
+}
+
+void LabelSliderBank::setPageStep(int step)
+{
+    if (m_pageStep == step)
+        return;
+    m_pageStep = qMax(1, step);
+    if (m_tickInterval == 0)
+        invalidateScale();
+}
+
+int LabelSliderBank::pageStep() const
+{
+    return m_pageStep;
+}
+
+void LabelSliderBank::setValue(int channel, int value)
+{
+    if (channel < 0 || channel >= m_channels.size())
+        return;
+
+    value = qBound(m_minimum, value, m_maximum);
+    if (m_channels.at(channel).value == value)
+        return;
+
+    m_channels[channel].value = value;
+    update(channelRect(channel));
+    emit valueChanged(channel, value);
+}
+
+int LabelSliderBank::value(int channel) const
+{
+    return channel >= 0 && channel < m_channels.size() ? m_channels.at(channel).value : 0;
+}
+
+bool LabelSliderBank::isSliderDown(int channel) const
+{
+    return channel >= 0 && channel < m_channels.size() && m_channels.at(channel).down;
+}
+
+void LabelSliderBank::setCurrentChannel(int channel)
+{
+    channel = qBound(0, channel, qMax(0, m_channels.size() - 1));
+    if (m_currentChannel == channel)
+        return;
+    update(channelRect(m_currentChannel));
+    m_currentChannel = channel;
+    update(channelRect(m_currentChannel));
+}
+
+int LabelSliderBank::currentChannel() const
+{
+    return m_currentChannel;
+}
+
+void LabelSliderBank::setTickPosition(QSlider::TickPosition position)
+{
+    if (m_tickPosition == position)
+        return;
+    m_tickPosition = position;
+    invalidateScale();
+    updateGeometry();
+}
+
+QSlider::TickPosition LabelSliderBank::tickPosition() const
+{
+    return m_tickPosition;
+}
+
+void LabelSliderBank::setTickInterval(int ti)
+{
+    ti = qMax(0, ti);
+    if (m_tickInterval == ti)
+        return;
+    m_tickInterval = ti;
+    invalidateScale();
+}
+
+int LabelSliderBank::tickInterval() const
+{
+    return m_tickInterval;
+}
+
+void LabelSliderBank::setTickValuesVisible(bool visible)
+{
+    if (m_showTickValues == visible)
+        return;
+    m_showTickValues = visible;
+    invalidateScale();
+    updateGeometry();
+}
+
+bool LabelSliderBank::tickValuesVisible() const
+{
+    return m_showTickValues;
+}
+
+void LabelSliderBank::setFormatType(LabelSlider::FormatType type)
+{
+    m_scale->setFormatType(type);
+    invalidateScale();
+}
+
+LabelSlider::FormatType LabelSliderBank::formatType() const
+{
+    return m_scale->formatType();
+}
+
+void LabelSliderBank::setFormatSuffix(const QString &suffix)
+{
+    m_scale->setFormatSuffix(suffix);
+    invalidateScale();
+}
+
+void LabelSliderBank::setFormatPrefixSuffix(const QString &prefix, const QString &suffix)
+{
+    m_scale->setFormatPrefixSuffix(prefix, suffix);
+    invalidateScale();
+}
+
+void LabelSliderBank::setPrintfFormat(const QString &format)
+{
+    m_scale->setPrintfFormat(format);
+    invalidateScale();
+}
+
+void LabelSliderBank::setDecimalPlaces(int places)
+{
+    m_scale->setDecimalPlaces(places);
+    invalidateScale();
+}
+
+void LabelSliderBank::setValueScale(double scale)
+{
+    m_scale->setValueScale(scale);
+    invalidateScale();
+}
+
+void LabelSliderBank::setCustomFormatter(std::function<QString(int)> formatter)
+{
+    m_scale->setCustomFormatter(formatter);
+    invalidateScale();
+}
+
+void LabelSliderBank::setCustomLabels(const QMap<int, QString> &labels)
+{
+    m_scale->setCustomLabels(labels);
+    invalidateScale();
+}
+
+QSize LabelSliderBank::sizeHint() const
+{
+    const QSize minimum = minimumSizeHint();
+    if (m_orientation == Qt::Vertical)
+        return QSize(minimum.width(), qMax(minimum.height(), 200));
+    return QSize(qMax(minimum.width(), 200), minimum.height());
+}
+
+QSize LabelSliderBank::minimumSizeHint() const
+{
+    const int across = labelExtent() + channelExtent() * m_channels.size();
+    const int length = 2 * fontMetrics().height();
+    return m_orientation == Qt::Vertical ? QSize(across, length) : QSize(length, across);
+}
+
+void LabelSliderBank::invalidateScale()
+{
+    m_scaleValid = false;
+    update();
+}
+
+int LabelSliderBank::labelExtent() const
+{
+    // Channel geometry and hit-testing hang off the label column, so it is
+    // measured again first if a setter or a font change made it stale.
+    const_cast<LabelSliderBank *>(this)->updateScale();
+    return m_labelExtent;
+}
+
+int LabelSliderBank::channelExtent() const
+{
+    QStyleOptionSlider opt;
+    opt.initFrom(this);
+    opt.orientation = m_orientation;
+    return style()->pixelMetric(QStyle::PM_SliderThickness, &opt, this) + channelSpacing;
+}
+
+QRect LabelSliderBank::labelRect() const
+{
+    if (m_orientation == Qt::Vertical)
+        return QRect(0, 0, labelExtent(), height());
+    return QRect(0, 0, width(), labelExtent());
+}
+
+QRect LabelSliderBank::channelRect(int channel) const
+{
+    // Channels share the space left next to the labels equally.
+    const int count = qMax(1, m_channels.size());
+    if (m_orientation == Qt::Vertical)
+    {
+        const int extent = qMax(1, (width() - labelExtent()) / count);
+        return QRect(labelExtent() + channel * extent, 0, extent, height());
+    }
+    const int extent = qMax(1, (height() - labelExtent()) / count);
+    return QRect(0, labelExtent() + channel * extent, width(), extent);
+}
+
+int LabelSliderBank::channelAt(const QPoint &pos) const
+{
+    if (m_channels.isEmpty())
+        return -1;
+    const QRect first = channelRect(0);
+    const int offset = m_orientation == Qt::Vertical ? pos.x() - first.x() : pos.y() - first.y();
+    const int extent = m_orientation == Qt::Vertical ? first.width() : first.height();
+    if (offset < 0)
+        return -1;
+    const int channel = offset / extent;
+    return channel < m_channels.size() ? channel : -1;
+}
+
+void LabelSliderBank::initChannelOption(QStyleOptionSlider *option, int channel) const
+{
+    const Channel &state = m_channels.at(channel);
+    option->initFrom(this);
+    option->rect = channelRect(channel);
+    option->orientation = m_orientation;
+    option->minimum = m_minimum;
+    option->maximum = m_maximum;
+    option->singleStep = m_singleStep;
+    option->pageStep = m_pageStep;
+    option->sliderPosition = state.value;
+    option->sliderValue = state.value;
+    option->tickPosition = m_tickPosition;
+    option->tickInterval = m_tickInterval;
+    option->upsideDown = m_orientation == Qt::Vertical;
+    option->subControls = QStyle::SC_SliderGroove | QStyle::SC_SliderHandle;
+    if (m_tickPosition != QSlider::NoTicks)
+        option->subControls |= QStyle::SC_SliderTickmarks;
+    if (state.down)
+    {
+        option->activeSubControls = QStyle::SC_SliderHandle;
+        option->state |= QStyle::State_Sunken;
+    }
+    if (channel != m_currentChannel)
+        option->state &= ~QStyle::State_HasFocus;
+}
+
+int LabelSliderBank::along(const QPoint &pos) const
+{
+    return m_orientation == Qt::Vertical ? pos.y() : pos.x();
+}
+
+int LabelSliderBank::valueAt(int position) const
+{
+    return QStyle::sliderValueFromPosition(m_minimum, m_maximum, position - m_grooveOrigin, m_grooveSpace,
+                                           m_orientation == Qt::Vertical);
+}
+
+void LabelSliderBank::updateScale()
+{
+    if (m_scaleValid)
+        return;
+    m_scaleValid = true;
+    m_ticks.clear();
+
+    // Every channel has the same groove along the main axis, so the first
+    // one's, in widget coordinates, places all tick labels.
+    QStyleOptionSlider opt;
+    opt.initFrom(this);
+    opt.rect = m_orientation == Qt::Vertical ? QRect(0, 0, channelExtent(), height())
+                                             : QRect(0, 0, width(), channelExtent());
+    opt.orientation = m_orientation;
+    opt.minimum = m_minimum;
+    opt.maximum = m_maximum;
+    opt.tickPosition = m_tickPosition;
+    const QRect groove = style()->subControlRect(QStyle::CC_Slider, &opt, QStyle::SC_SliderGroove, this);
+    const int sliderLength = style()->pixelMetric(QStyle::PM_SliderLength, &opt, this);
+    const bool vertical = m_orientation == Qt::Vertical;
+    m_grooveOrigin = (vertical ? groove.y() : groove.x()) + sliderLength / 2;
+    m_grooveSpace = qMax(1, (vertical ? groove.height() : groove.width()) - sliderLength);
+
+    // Like LabelSlider, no ticks means no tick labels either.
+    m_labelExtent = 0;
+    if (!m_showTickValues || m_tickPosition == QSlider::NoTicks)
+        return;
+
+    // Label every tick that fits; a long range labels every n-th tick.
+    const QFontMetrics metrics = fontMetrics();
+    const qint64 interval = m_tickInterval > 0 ? m_tickInterval : m_pageStep;
+    const qint64 count = (qint64(m_maximum) - m_minimum) / interval + 1;
+    int labelLength = metrics.height();
+    if (!vertical)
+    {
+        labelLength = qMax(metrics.size(Qt::TextSingleLine, m_scale->valueText(m_minimum)).width(),
+                           metrics.size(Qt::TextSingleLine, m_scale->valueText(m_maximum)).width());
+    }
+    const qint64 fitting = qMax<qint64>(1, m_grooveSpace / (labelLength + labelSpacing) + 1);
+    const qint64 stride = (count + fitting - 1) / fitting;
+
+    m_ticks.reserve(static_cast<int>(qMin(count, fitting)));
+    for (qint64 i = 0; i < count; i += stride)
+    {
+        Tick tick;
+        tick.value = static_cast<int>(m_minimum + i * interval);
+        tick.text = m_scale->valueText(tick.value);
+        tick.size = metrics.size(Qt::TextSingleLine, tick.text);
+        tick.pos = m_grooveOrigin + QStyle::sliderPositionFromValue(m_minimum, m_maximum, tick.value,
+                                                                    m_grooveSpace, vertical);
+        m_labelExtent = qMax(m_labelExtent, vertical ? tick.size.width() : tick.size.height());
+        m_ticks.append(tick);
+    }
+    m_labelExtent += labelSpacing;
+}
+
+void LabelSliderBank::paintEvent(QPaintEvent *event)
+{
+    updateScale();
+
+    QPainter painter(this);
+    const QRect dirty = event->rect();
+    const QRect labels = labelRect();
+    if (!m_ticks.isEmpty() && dirty.intersects(labels))
+    {
+        painter.setPen(palette().color(QPalette::WindowText));
+        for (const Tick &tick : m_ticks)
+        {
+            QRect rect(QPoint(), tick.size);
+            if (m_orientation == Qt::Vertical)
+            {
+                rect.moveTopRight(QPoint(labels.right() - labelSpacing,
+                                         qBound(0, tick.pos - tick.size.height() / 2, height() - tick.size.height())));
+            }
+            else
+            {
+                rect.moveTopLeft(QPoint(qBound(0, tick.pos - tick.size.width() / 2, width() - tick.size.width()),
+                                        labels.bottom() - labelSpacing - tick.size.height() + 1));
+            }
+            if (rect.intersects(dirty))
+                painter.drawText(rect, Qt::AlignCenter, tick.text);
+        }
+    }
+
+    // Only the channels the update touched are drawn.
+    if (m_channels.isEmpty())
+        return;
+    const QRect channels = channelRect(0);
+    const bool vertical = m_orientation == Qt::Vertical;
+    const int extent = vertical ? channels.width() : channels.height();
+    const int start = vertical ? channels.x() : channels.y();
+    const int first = qMax(0, ((vertical ? dirty.left() : dirty.top()) - start) / extent);
+    const int last = qMin(m_channels.size() - 1, ((vertical ? dirty.right() : dirty.bottom()) - start) / extent);
+    QStyleOptionSlider opt;
+    for (int i = first; i <= last; ++i)
+    {
+        initChannelOption(&opt, i);
+        style()->drawComplexControl(QStyle::CC_Slider, &opt, &painter, this);
+    }
+}
+
+void LabelSliderBank::resizeEvent(QResizeEvent *event)
+{
+    invalidateScale();
+    QWidget::resizeEvent(event);
+}
+
+void LabelSliderBank::changeEvent(QEvent *event)
+{
+    if (event->type() == QEvent::StyleChange || event->type() == QEvent::FontChange)
+    {
+        invalidateScale();
+        updateGeometry();
+    }
+    QWidget::changeEvent(event);
+}
+
+void LabelSliderBank::mousePressEvent(QMouseEvent *event)
+{
+    const QPoint pos = eventPos(event);
+    const int channel = channelAt(pos);
+    if (event->button() != Qt::LeftButton || channel < 0)
+    {
+        event->ignore();
+        return;
+    }
+
+    updateScale();
+    setCurrentChannel(channel);
+    QStyleOptionSlider opt;
+    initChannelOption(&opt, channel);
+    const QStyle::SubControl hit = style()->hitTestComplexControl(QStyle::CC_Slider, &opt, pos, this);
+    if (hit == QStyle::SC_SliderHandle)
+    {
+        const QRect handle = style()->subControlRect(QStyle::CC_Slider, &opt, QStyle::SC_SliderHandle, this);
+        m_pressedChannel = channel;
+        m_dragOffset = along(pos) - along(handle.topLeft());
+        m_channels[channel].down = true;
+        update(channelRect(channel));
+        emit sliderPressed(channel);
+    }
+    else if (hit == QStyle::SC_SliderGroove)
+    {
+        // Paging towards the click, as QSlider does by default.
+        const int target = valueAt(along(pos));
+        stepChannel(channel, target > m_channels.at(channel).value ? m_pageStep : -m_pageStep);
+    }
+    event->accept();
+}
+
+void LabelSliderBank::mouseMoveEvent(QMouseEvent *event)
+{
+    if (m_pressedChannel < 0)
+    {
+        event->ignore();
+        return;
+    }
+
+    QStyleOptionSlider opt;
+    initChannelOption(&opt, m_pressedChannel);
+    const int length = style()->pixelMetric(QStyle::PM_SliderLength, &opt, this);
+    const int value = valueAt(along(eventPos(event)) - m_dragOffset + length / 2);
+    if (value != m_channels.at(m_pressedChannel).value)
+    {
+        setValue(m_pressedChannel, value);
+        emit sliderMoved(m_pressedChannel, value);
+    }
+    event->accept();
+}
+
+void LabelSliderBank::mouseReleaseEvent(QMouseEvent *event)
+{
+    if (m_pressedChannel < 0 || event->button() != Qt::LeftButton)
+    {
+        event->ignore();
+        return;
+    }
+
+    const int channel = m_pressedChannel;
+    m_pressedChannel = -1;
+    m_channels[channel].down = false;
+    update(channelRect(channel));
+    emit sliderReleased(channel);
+    event->accept();
+}
+
+void LabelSliderBank::wheelEvent(QWheelEvent *event)
+{
+    const int channel = channelAt(eventPos(event));
+    const int delta = event->angleDelta().y();
+    if (channel < 0 || delta == 0)
+    {
+        event->ignore();
+        return;
+    }
+
+    // Touchpads and smooth-scrolling mice send fractions of a notch, which
+    // add up to whole steps as in QSlider.
+    if (channel != m_wheelChannel)
+    {
+        m_wheelChannel = channel;
+        m_wheelRemainder = 0;
+    }
+    m_wheelRemainder += delta;
+    const int steps = m_wheelRemainder / 120;
+    m_wheelRemainder -= steps * 120;
+    if (steps != 0)
+        stepChannel(channel, qint64(steps) * m_singleStep);
+    event->accept();
+}
+
+void LabelSliderBank::keyPressEvent(QKeyEvent *event)
+{
+    if (m_channels.isEmpty())
+    {
+        QWidget::keyPressEvent(event);
+        return;
+    }
+
+    // Arrows along the sliders step the value; arrows across them move
+    // between channels.
+    const bool vertical = m_orientation == Qt::Vertical;
+    const int channel = m_currentChannel;
+    switch (event->key())
+    {
+    case Qt::Key_Up:
+        vertical ? stepChannel(channel, m_singleStep) : setCurrentChannel(channel - 1);
+        break;
+    case Qt::Key_Down:
+        vertical ? stepChannel(channel, -m_singleStep) : setCurrentChannel(channel + 1);
+        break;
+    case Qt::Key_Right:
+        vertical ? setCurrentChannel(channel + 1) : stepChannel(channel, m_singleStep);
+        break;
+    case Qt::Key_Left:
+        vertical ? setCurrentChannel(channel - 1) : stepChannel(channel, -m_singleStep);
+        break;
+    case Qt::Key_PageUp:
+        stepChannel(channel, m_pageStep);
+        break;
+    case Qt::Key_PageDown:
+        stepChannel(channel, -m_pageStep);
+        break;
+    case Qt::Key_Home:
+        setValue(channel, m_minimum);
+        break;
+    case Qt::Key_End:
+        setValue(channel, m_maximum);
+        break;
+    default:
+        QWidget::keyPressEvent(event);
+        return;
+    }
+    event->accept();
+}
+
+void LabelSliderBank::stepChannel(int channel, qint64 delta)
+{
+    const qint64 value = m_channels.at(channel).value + delta;
+    setValue(channel, static_cast<int>(qBound<qint64>(m_minimum, value, m_maximum)));
+}
@@ -0,0 +1,145 @@
+#ifndef LABELSLIDERBANK_H
+#define LABELSLIDERBANK_H
+
+#include <QMap>
+#include <QSlider>
+#include <QString>
+#include <QVector>
+#include <QWidget>
+#include <functional>
+
+#include "labelslider.h"
+
+class QStyleOptionSlider;
+
+// A row (or column) of sliders sharing one scale, drawn by a single widget:
+// one tick-label column and N slider channels painted with the style, with
+// mouse, wheel and keyboard input routed to the channel under the pointer or
+// with focus. Range, ticks and formatting apply to every channel; values and
+// signals are per channel.
+class LabelSliderBank : public QWidget
+{
+    Q_OBJECT
+
+  public:
+    explicit LabelSliderBank(int channels = 0, Qt::Orientation orientation = Qt::Vertical,
+                             QWidget *parent = nullptr);
+
+    ~LabelSliderBank();
+
+    void setChannelCount(int channels);
+    int channelCount() const;
+
+    void setOrientation(Qt::Orientation orientation);
+    Qt::Orientation orientation() const;
+
+    void setRange(int min, int max);
+    int minimum() const;
+    int maximum() const;
+
+    void setSingleStep(int step);
+    int singleStep() const;
+
+    void setPageStep(int step);
+    int pageStep() const;
+
+    void setValue(int channel, int value);
+    int value(int channel) const;
+    bool isSliderDown(int channel) const;
+
+    void setCurrentChannel(int channel);
+    int currentChannel() const;
+
+    void setTickPosition(QSlider::TickPosition position);
+    QSlider::TickPosition tickPosition() const;
+
+    void setTickInterval(int ti);
+    int tickInterval() const;
+
+    void setTickValuesVisible(bool visible);
+    bool tickValuesVisible() const;
+
+    void setFormatType(LabelSlider::FormatType type);
+    LabelSlider::FormatType formatType() const;
+    void setFormatSuffix(const QString &suffix);
+    void setFormatPrefixSuffix(const QString &prefix, const QString &suffix);
+    void setPrintfFormat(const QString &format);
+    void setDecimalPlaces(int places);
+    void setValueScale(double scale);
+    void setCustomFormatter(std::function<QString(int)> formatter);
+    void setCustomLabels(const QMap<int, QString> &labels);
+
+    QSize sizeHint() const override;
+    QSize minimumSizeHint() const override;
+
+  signals:
+    void valueChanged(int channel, int value);
+    void sliderMoved(int channel, int position);
+    void sliderPressed(int channel);
+    void sliderReleased(int channel);
+    void rangeChanged(int min, int max);
+
+  protected:
+    void changeEvent(QEvent *event) override;
+    void paintEvent(QPaintEvent *event) override;
+    void resizeEvent(QResizeEvent *event) override;
+    void mousePressEvent(QMouseEvent *event) override;
+    void mouseMoveEvent(QMouseEvent *event) override;
+    void mouseReleaseEvent(QMouseEvent *event) override;
+    void wheelEvent(QWheelEvent *event) override;
+    void keyPressEvent(QKeyEvent *event) override;
+
+  private:
+    struct Channel
+    {
+        int value = 0;
+        bool down = false;
+    };
+
+    struct Tick
+    {
+        int value;
+        QString text;
+        QSize size;
+        int pos;
+    };
+
+    void invalidateScale();
+    void updateScale();
+    int labelExtent() const;
+    int channelExtent() const;
+    QRect labelRect() const;
+    QRect channelRect(int channel) const;
+    int channelAt(const QPoint &pos) const;
+    void initChannelOption(QStyleOptionSlider *option, int channel) const;
+    int along(const QPoint &pos) const;
+    int valueAt(int position) const;
+    void stepChannel(int channel, qint64 delta);
+
+    // Texts come from a hidden LabelSlider, so the bank formats exactly like
+    // the single widget and shares its memo and settings.
+    LabelSlider *m_scale;
+    Qt::Orientation m_orientation;
+    QVector<Channel> m_channels;
+    int m_minimum = 0;
+    int m_maximum = 99;
+    int m_singleStep = 1;
+    int m_pageStep = 10;
+    int m_tickInterval = 0;
+    QSlider::TickPosition m_tickPosition = QSlider::TicksBothSides;
+    bool m_showTickValues = true;
+    int m_currentChannel = 0;
+    int m_pressedChannel = -1;
+    int m_dragOffset = 0;
+    int m_wheelChannel = -1;
+    int m_wheelRemainder = 0;
+
+    // Derived from the style, the size and the scale; rebuilt lazily.
+    bool m_scaleValid = false;
+    QVector<Tick> m_ticks;
+    int m_labelExtent = 0;
+    int m_grooveOrigin = 0;
+    int m_grooveSpace = 0;
+};
+
+#endif // LABELSLIDERBANK_H
@@ -0,0 +1,83 @@
+#include "labelslidergroup.h"
+
+#include <QSignalBlocker>
+#include <QVector>
+
+#include "labelslider.h"
+
+LabelSliderGroup::LabelSliderGroup(QObject *parent) : QObject(parent)
+{
+}
+
+LabelSliderGroup::~LabelSliderGroup()
+{
+}
+
+void LabelSliderGroup::addSlider(LabelSlider *slider)
+{
+    if (!slider || m_sliders.contains(slider))
+        return;
+    m_sliders.append(slider);
+    // The slider is already gone by then, so only the stored address is
+    // compared, never the object.
+    connect(slider, &QObject::destroyed, this, [this, slider]() { m_sliders.removeAll(slider); });
+}
+
+void LabelSliderGroup::removeSlider(LabelSlider *slider)
+{
+    if (m_sliders.removeAll(slider))
+        disconnect(slider, nullptr, this, nullptr);
+}
+
+QList<LabelSlider *> LabelSliderGroup::sliders() const
+{
+    return m_sliders;
+}
+
+int LabelSliderGroup::count() const
+{
+    return m_sliders.size();
+}
+
+QByteArray LabelSliderGroup::saveState() const
+{
+    QVector<LabelSlider::State> states;
+    states.reserve(m_sliders.size());
+    for (const LabelSlider *slider : m_sliders)
+    {
+        states.append(slider->state());
+    }
+    return LabelSlider::encodeStates(states);
+}
+
+bool LabelSliderGroup::restoreState(const QByteArray &state)
+{
+    // The whole preset is decoded and checked before any slider changes, so a
+    // bad one leaves every slider as it was.
+    QVector<LabelSlider::State> states;
+    if (!LabelSlider::decodeStates(state, &states) || states.size() != m_sliders.size())
+        return false;
+
+    // Every slider holds its update open until all of them are recalled, and
+    // none of them signals, so no handler ever sees half a preset. Closing the
+    // updates then queues all the label flushes for the same pass.
+    for (LabelSlider *slider : m_sliders)
+    {
+        slider->beginUpdate();
+    }
+    QList<LabelSlider *> changed;
+    for (int i = 0; i < m_sliders.size(); ++i)
+    {
+        LabelSlider *slider = m_sliders.at(i);
+        const QSignalBlocker blocker(slider);
+        if (slider->applyState(states.at(i), true))
+            changed.append(slider);
+    }
+    for (LabelSlider *slider : m_sliders)
+    {
+        slider->endUpdate();
+    }
+
+    emit stateRestored(changed);
+    return true;
+}
@@ -0,0 +1,38 @@
+#ifndef LABELSLIDERGROUP_H
+#define LABELSLIDERGROUP_H
+
+#include <QByteArray>
+#include <QList>
+#include <QObject>
+
+class LabelSlider;
+
+// An ordered set of LabelSliders saved and recalled as one preset. Recall
+// applies every slider with its signals blocked and its label rebuild held
+// back, so the whole set lays out and repaints once, on the next event-loop
+// pass, and reports what changed through a single stateRestored().
+class LabelSliderGroup : public QObject
+{
+    Q_OBJECT
+
+  public:
+    explicit LabelSliderGroup(QObject *parent = nullptr);
+
+    ~LabelSliderGroup();
+
+    void addSlider(LabelSlider *slider);
+    void removeSlider(LabelSlider *slider);
+    QList<LabelSlider *> sliders() const;
+    int count() const;
+
+    QByteArray saveState() const;
+    bool restoreState(const QByteArray &state);
+
+  signals:
+    void stateRestored(const QList<LabelSlider *> &changed);
+
+  private:
+    QList<LabelSlider *> m_sliders;
+};
+
+#endif // LABELSLIDERGROUP_H
@@ -78,6 +78,7 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent), ui(new Ui::MainWi
     labelSlider7->setTickInterval(20);
     labelSlider7->setTickPosition(QSlider::TicksBothSides);
     labelSlider7->setTickValuesVisible(true);
+    labelSlider7->setScaleType(LabelSlider::LogarithmicScale);
     labelSlider7->setFormatType(LabelSlider::CustomFunction);
     labelSlider7->setCustomFormatter([](int value) -> QString {
         if (value == 0)